@@ -1,211 +1,1108 @@
-/**
- * A4Header.h
- * @author kisslune 
- */
-
-#ifndef ANSWERS_A4HEADER_H
-#define ANSWERS_A4HEADER_H
-
-#include <utility>
-
-#include "SVF-LLVM/SVFIRBuilder.h"
-
-using EdgeLabel = unsigned;
-
-enum EdgeLabelType
-{
-    Addr, AddrBar,
-    Copy, CopyBar,
-    Store, StoreBar,
-    Load, LoadBar,
-    PT, PTBar,
-    SV, SVBar,
-    PV, PVBar,
-    VP, VPBar,
-    VF, VFBar,
-    VA, VABar,
-    LV, LVBar,
-};
-
-
-/**
- * The edge type of CFL-reachability
- */
-struct CFLREdge
-{
-    unsigned src;   // source
-    unsigned dst;   // target
-    EdgeLabel label;
-
-    CFLREdge(unsigned src, unsigned dst, EdgeLabel lbl) :
-            src(src), dst(dst), label(lbl)
-    {}
-
-    inline bool operator<(const CFLREdge &rhs) const
-    {
-        if (src != rhs.src) return src < rhs.src;
-        if (dst != rhs.dst) return dst < rhs.dst;
-        return label < rhs.label;
-    }
-
-    inline bool operator==(const CFLREdge &rhs) const
-    {
-        return (src == rhs.src) && (dst == rhs.dst) && (label == rhs.label);
-    }
-};
-
-
-template<>
-struct std::hash<CFLREdge>
-{
-    size_t operator()(const CFLREdge &edge) const
-    { return ((uint64_t) edge.src << 32) | (uint64_t) edge.dst; }
-};
-
-
-/**
- * The graph for CFL-reachability-based pointer analysis
- */
-class CFLRGraph
-{
-public:
-    /// We use a source -> label -> target map to represent the adjacency list of the predecessors/successors of nodes.
-    using DataMap = std::unordered_map<unsigned, std::unordered_map<EdgeLabel, std::unordered_set<unsigned>>>;
-
-    /// Construct a graph from a PAG
-    explicit CFLRGraph(SVF::SVFIR *pag);
-
-    /**
-     * Check whether an edge is already in the graph
-     * @param src the source node of the edge
-     * @param dst the target node of the edge
-     * @param label the label of the edge
-     * @return true of the edge already exists, false otherwise
-     */
-    bool hasEdge(unsigned src, unsigned dst, EdgeLabel label);
-
-    /**
-     * Add an edge to the graph
-     * @param src the source node of the edge
-     * @param dst the target node of the edge
-     * @param label the label of the edge
-     */
-    void addEdge(unsigned src, unsigned dst, EdgeLabel label);
-
-    DataMap &getSuccessorMap()
-    { return succMap; }
-
-    DataMap &getPredecessorMap()
-    { return predMap; }
-    
-    /**
-     * Get all successor nodes with a specific edge label
-     * @param src the source node
-     * @param label the edge label
-     * @return a set of successor nodes
-     */
-    std::unordered_set<unsigned> getSuccessors(unsigned src, EdgeLabel label);
-
-    /**
-     * Get all predecessor nodes with a specific edge label
-     * @param dst the destination node
-     * @param label the edge label
-     * @return a set of predecessor nodes
-     */
-    std::unordered_set<unsigned> getPredecessors(unsigned dst, EdgeLabel label);
-    
-    /**
-     * Check if a node is an object node
-     * @param node the node to check
-     * @return true if the node is an object node, false otherwise
-     */
-    bool isObjectNode(unsigned node);
-    
-    /**
-     * Check if a node is a special node (like DummyObjVar)
-     * @param node the node to check
-     * @return true if the node is a special node, false otherwise
-     */
-    bool isSpecialNode(unsigned node);
-
-protected:
-    DataMap predMap;   // holding predecessors
-    DataMap succMap;   // holding successors
-};
-
-
-/**
- * FIFO worklist
- */
-template<class T>
-class WorkList
-{
-public:
-    /// Check whether the worklist is empty.
-    inline bool empty() const
-    { return data_list.empty(); }
-
-    /// Clear the worklist
-    inline void clear()
-    {
-        data_list.clear();
-        data_set.clear();
-    }
-
-    /// Push a data into the END work list.
-    inline bool push(const T &data)
-    {
-        if (data_set.find(data) == data_set.end())
-        {
-            this->data_list.push_back(data);
-            this->data_set.insert(data);
-            return true;
-        }
-        else
-            return false;
-    }
-
-    /// Pop a data from the FRONT of work list.
-    inline T pop()
-    {
-        assert(!this->empty() && "work list is empty");
-        T data = this->data_list.front();
-        this->data_list.pop_front();
-        this->data_set.erase(data);
-        return data;
-    }
-
-protected:
-    std::unordered_set<T> data_set;       ///< to avoid duplicate elements
-    std::deque<T> data_list;     ///< to access the elements at both the beginning and the end
-};
-
-
-/**
- * CFL-reachability implementation
- */
-class CFLR
-{
-    WorkList<CFLREdge> workList;
-    CFLRGraph *graph;
-
-public:
-    CFLR() : graph(nullptr)
-    {}
-
-    ~CFLR()
-    { delete graph; }
-
-    /// Build a graph from PAG
-    void buildGraph(SVF::PAG *pag);
-
-    void addEdgeToWorklist(unsigned src, unsigned dst, EdgeLabel label);
-    void applyProductionRules(const CFLREdge& edge);
-    
-    /// The dynamic-programming CFL-reachability algorithm.
-    void solve();
-    /// Dump results into a file
-    void dumpResult();
-};
-
-#endif //ANSWERS_A4HEADER_H
+/**
+ * A4Header.h
+ * @author kisslune 
+ */
+
+#ifndef ANSWERS_A4HEADER_H
+#define ANSWERS_A4HEADER_H
+
+#include <atomic>
+#include <chrono>
+#include <utility>
+
+#include "SVF-LLVM/SVFIRBuilder.h"
+#include "AdjacencyIndex.h"
+#include "SparseBitSet.h"
+#include "PointsToFile.h"
+#include "ResultWriter.h"
+#include "SolverStats.h"
+#include "UnionFind.h"
+#include "VariableSubstitution.h"
+
+using EdgeLabel = unsigned;
+
+enum EdgeLabelType
+{
+    Addr, AddrBar,
+    Copy, CopyBar,
+    Store, StoreBar,
+    Load, LoadBar,
+    PT, PTBar,
+    SV, SVBar,
+    PV, PVBar,
+    VP, VPBar,
+    VF, VFBar,
+    VA, VABar,
+    LV, LVBar,
+};
+
+
+/**
+ * The edge type of CFL-reachability
+ */
+struct CFLREdge
+{
+    unsigned src;   // source
+    unsigned dst;   // target
+    EdgeLabel label;
+
+    CFLREdge() : src(0), dst(0), label(0)
+    {}
+
+    CFLREdge(unsigned src, unsigned dst, EdgeLabel lbl) :
+            src(src), dst(dst), label(lbl)
+    {}
+
+    inline bool operator<(const CFLREdge &rhs) const
+    {
+        if (src != rhs.src) return src < rhs.src;
+        if (dst != rhs.dst) return dst < rhs.dst;
+        return label < rhs.label;
+    }
+
+    inline bool operator==(const CFLREdge &rhs) const
+    {
+        return (src == rhs.src) && (dst == rhs.dst) && (label == rhs.label);
+    }
+};
+
+
+template<>
+struct std::hash<CFLREdge>
+{
+    size_t operator()(const CFLREdge &edge) const
+    {
+        uint64_t key = ((uint64_t) edge.src << 32) | (uint64_t) edge.dst;
+        return std::hash<uint64_t>()(key ^ ((uint64_t) edge.label * 0x9e3779b97f4a7c15ULL));
+    }
+};
+
+
+/**
+ * A context-free grammar over edge labels. The CFL-reachability algorithm joins the rule
+ * shapes A ::= epsilon, A ::= B and A ::= B C; longer rules are kept aside until
+ * normalize() rewrites the grammar into that form.
+ * Rules are indexed by their operands, so that a new edge only visits the rules it
+ * can take part in.
+ */
+class CFLGrammar
+{
+public:
+    struct UnaryRule
+    {
+        EdgeLabel head;
+        EdgeLabel body;
+    };
+
+    struct BinaryRule
+    {
+        EdgeLabel head;
+        EdgeLabel left;
+        EdgeLabel right;
+    };
+
+    /// A binary rule seen from one operand: its head and the other operand
+    struct Partner
+    {
+        EdgeLabel head;
+        EdgeLabel other;
+    };
+
+    /// An empty grammar that knows the labels of EdgeLabelType by name
+    CFLGrammar();
+
+    /// The grammar of field-insensitive points-to analysis
+    static CFLGrammar pointsTo();
+
+    /**
+     * Read rules from a grammar file. Each line holds "A ::= B C | D | epsilon"; labels
+     * not in EdgeLabelType become new nonterminals, '#' starts a comment.
+     * @return false if the file cannot be read or has a malformed rule
+     */
+    bool loadFromFile(const std::string &fname);
+
+    /**
+     * Rewrite the grammar into binary normal form:
+     *  - A ::= X1 X2 ... Xn is split into A ::= X1 <X2 ... Xn>, <X2 ... Xn> ::= X2 <X3 ... Xn>, ...
+     *    where rules with the same suffix share its label;
+     *  - epsilon is folded into the other rules: for every nullable B, A ::= B C also gives
+     *    A ::= C (likewise for a nullable C), so no edge ever has to stand for epsilon;
+     *  - chains of unary rules are closed, so A ::= B ::= C also gives A ::= C.
+     * Only nonempty paths are derived afterwards; nullable labels lose their self-loops.
+     */
+    void normalize();
+
+    /// Check whether two grammars have the same rules over the same label IDs
+    bool sameRules(const CFLGrammar &other) const;
+
+    /// Get the label with a name, adding a new label if there is none
+    EdgeLabel getLabel(const std::string &name);
+
+    const std::string &getLabelName(EdgeLabel label) const
+    { return labelNames[label]; }
+
+    unsigned getLabelNum() const
+    { return labelNames.size(); }
+
+    /// Add head ::= body for a body of any length
+    void addRule(EdgeLabel head, const std::vector<EdgeLabel> &body);
+    void addEpsilonRule(EdgeLabel head);
+    /// @return false if the rule is already there or is the trivial A ::= A
+    bool addUnaryRule(EdgeLabel head, EdgeLabel body);
+    void addBinaryRule(EdgeLabel head, EdgeLabel left, EdgeLabel right);
+
+    /// Labels A with A ::= epsilon; after normalize(), every label that derives epsilon
+    const std::vector<EdgeLabel> &getEpsilonLabels() const
+    { return epsilonLabels; }
+
+    /// Heads A of the rules A ::= body
+    const std::vector<EdgeLabel> &getUnaryHeads(EdgeLabel body) const
+    { return body < unaryHeads.size() ? unaryHeads[body] : noLabels; }
+
+    /// Bodies B of the rules head ::= B
+    const std::vector<EdgeLabel> &getUnaryBodies(EdgeLabel head) const
+    { return head < unaryBodies.size() ? unaryBodies[head] : noLabels; }
+
+    /// The rules head ::= B C
+    const std::vector<BinaryRule> &getHeadRules(EdgeLabel head) const
+    { return head < headRules.size() ? headRules[head] : noRules; }
+
+    /// {A, C} for the rules A ::= left C
+    const std::vector<Partner> &getLeftRules(EdgeLabel left) const
+    { return left < leftRules.size() ? leftRules[left] : noPartners; }
+
+    /// {A, B} for the rules A ::= B right
+    const std::vector<Partner> &getRightRules(EdgeLabel right) const
+    { return right < rightRules.size() ? rightRules[right] : noPartners; }
+
+    const std::vector<UnaryRule> &getUnaryRules() const
+    { return unaryRules; }
+
+    const std::vector<BinaryRule> &getBinaryRules() const
+    { return binaryRules; }
+
+protected:
+    std::vector<std::string> labelNames;
+    std::unordered_map<std::string, EdgeLabel> labelIds;
+
+    std::vector<EdgeLabel> epsilonLabels;
+    std::vector<UnaryRule> unaryRules;
+    std::vector<BinaryRule> binaryRules;
+    std::vector<std::pair<EdgeLabel, std::vector<EdgeLabel>>> longRules;   // waiting for normalize()
+
+    // dispatch tables, indexed by operand label
+    std::vector<std::vector<EdgeLabel>> unaryHeads;
+    std::vector<std::vector<Partner>> leftRules;
+    std::vector<std::vector<Partner>> rightRules;
+
+    // demand tables, indexed by head label
+    std::vector<std::vector<EdgeLabel>> unaryBodies;
+    std::vector<std::vector<BinaryRule>> headRules;
+
+    static const std::vector<EdgeLabel> noLabels;
+    static const std::vector<Partner> noPartners;
+    static const std::vector<BinaryRule> noRules;
+};
+
+
+/// How the edges of a label are stored
+enum class LabelStorage
+{
+    Adjacency,  // sorted CSR rows, see AdjacencyIndex
+    BitSet,     // a sparse bitset per node, see BitSetIndex
+};
+
+
+/**
+ * The graph for CFL-reachability-based pointer analysis
+ */
+class CFLRGraph
+{
+public:
+    /// Adjacency directions of a label, see setLabelDirections
+    static constexpr unsigned Forward = 1;          // successors of every node
+    static constexpr unsigned Backward = 2;         // predecessors of every node
+    static constexpr unsigned BothDirections = Forward | Backward;
+
+    /**
+     * Construct a graph from a PAG
+     * @param nodeMap the node that replaces each PAG node, see VariableSubstitution;
+     *                nodes past its end are kept as they are
+     */
+    explicit CFLRGraph(SVF::SVFIR *pag, const std::vector<unsigned> &nodeMap = {});
+
+    /**
+     * Construct a graph from statements: edges labelled Addr, Copy, Store or Load, each
+     * added together with its Bar edge. EdgeList::read loads them from a file, without SVF.
+     * @param nodeMap as above
+     */
+    explicit CFLRGraph(const std::vector<CFLREdge> &stmts, const std::vector<unsigned> &nodeMap = {});
+
+    /**
+     * Check whether an edge is already in the graph
+     * @param src the source node of the edge
+     * @param dst the target node of the edge
+     * @param label the label of the edge
+     * @return true of the edge already exists, false otherwise
+     */
+    bool hasEdge(unsigned src, unsigned dst, EdgeLabel label) const;
+
+    /**
+     * Add an edge to the graph
+     * @param src the source node of the edge
+     * @param dst the target node of the edge
+     * @param label the label of the edge
+     */
+    void addEdge(unsigned src, unsigned dst, EdgeLabel label)
+    { insertIfAbsent(src, dst, label); }
+
+    /**
+     * Remove an edge from the graph; not to be called concurrently with insertions
+     * @return true if the edge was in the graph
+     */
+    bool removeEdge(unsigned src, unsigned dst, EdgeLabel label);
+
+    /**
+     * Add many edges at once; duplicates are dropped. A label that has no edges yet is laid
+     * out as CSR in one go instead of edge by edge.
+     * @param edges the edges to add, sorted by the call
+     */
+    void addEdges(std::vector<CFLREdge> &edges);
+
+    /**
+     * Add an edge unless it is already in the graph, looking it up only once.
+     * Once the graph is split into several shards (see setShardNum), threads may call this
+     * concurrently for labels reserved beforehand; each call only locks the shards of src and dst.
+     * @return true if the edge was new
+     */
+    bool insertIfAbsent(unsigned src, unsigned dst, EdgeLabel label);
+
+    /**
+     * Get all successor nodes with a specific edge label; the label must be kept Forward
+     * @param src the source node
+     * @param label the edge label
+     * @return a set of successor nodes
+     */
+    std::unordered_set<unsigned> getSuccessors(unsigned src, EdgeLabel label) const;
+
+    /**
+     * Get all predecessor nodes with a specific edge label; the label must be kept Backward
+     * @param dst the destination node
+     * @param label the edge label
+     * @return a set of predecessor nodes
+     */
+    std::unordered_set<unsigned> getPredecessors(unsigned dst, EdgeLabel label) const;
+
+    /// Append the successors of src along label to out, without building a set
+    void collectSuccessors(unsigned src, EdgeLabel label, std::vector<unsigned> &out) const;
+
+    /// Append the predecessors of dst along label to out, without building a set
+    void collectPredecessors(unsigned dst, EdgeLabel label, std::vector<unsigned> &out) const;
+
+    /**
+     * Add every successor of src along srcLabel as a successor of dst along dstLabel,
+     * a word at a time. Only applicable when both labels are stored as bitsets, forward.
+     * @param added receives the newly added successors of dst
+     * @return false if either label is not stored as bitsets, or is mirrored
+     */
+    bool unionSuccessors(unsigned dst, EdgeLabel dstLabel, unsigned src, EdgeLabel srcLabel,
+                         std::vector<unsigned> &added);
+
+    /**
+     * Replace the edges of a label with srcs[i] -> dsts[i], laid out as CSR in one go
+     * when the graph is not sharded. The edges must be distinct.
+     */
+    void assignEdges(EdgeLabel label, const std::vector<unsigned> &srcs, const std::vector<unsigned> &dsts);
+
+    /// Choose how the edges of a label are stored; existing edges are moved over
+    void setLabelStorage(EdgeLabel label, LabelStorage storage);
+
+    LabelStorage getLabelStorage(EdgeLabel label) const
+    {
+        EdgeLabel stored = getStoredLabel(label);
+        return stored < labels.size() ? labels[stored].storage : LabelStorage::Adjacency;
+    }
+
+    /**
+     * Choose which adjacency directions of a label are kept, a mask of Forward and Backward.
+     * Most labels are only ever probed one way, so the other index is dead weight. Lookups
+     * and visits of every edge use whichever is kept; dropping a direction frees it, adding
+     * one rebuilds it from the other. 0, for a label that is never probed, keeps Forward.
+     * For a mirrored label this sets the reverse directions of its stored label.
+     */
+    void setLabelDirections(EdgeLabel label, unsigned directions);
+
+    unsigned getLabelDirections(EdgeLabel label) const
+    {
+        EdgeLabel stored = getStoredLabel(label);
+        unsigned directions = stored < labels.size() ? labels[stored].directions : BothDirections;
+        return stored == label ? directions : reverseDirections(directions);
+    }
+
+    /// Swap Forward and Backward in a mask of directions
+    static unsigned reverseDirections(unsigned directions)
+    { return ((directions & Forward) ? Backward : 0) | ((directions & Backward) ? Forward : 0); }
+
+    /**
+     * Serve the edges of bar from the reverse of label's index: x -bar-> y holds exactly when
+     * y -label-> x does, so the pair is stored once. Every query, insertion and removal on bar
+     * goes to label with the ends swapped. The edges bar has so far are moved over.
+     * Only sound for a grammar that derives bar exactly as the reverse of label.
+     */
+    void mirrorLabel(EdgeLabel bar, EdgeLabel label);
+
+    /// The label whose index holds the edges of label: label itself unless it is mirrored
+    EdgeLabel getStoredLabel(EdgeLabel label) const
+    { return label < storedLabels.size() ? storedLabels[label] : label; }
+
+    /// The label served reversed from the same index as label, or label itself if there is none
+    EdgeLabel getReverseLabel(EdgeLabel label) const
+    { return label < reverseLabels.size() ? reverseLabels[label] : label; }
+
+    /// Visit every stored edge of the graph as (src, dst, label); the edges of a mirrored
+    /// label are visited once, as the reversed edges of its stored label
+    template<class F>
+    void forEachEdge(F f) const
+    {
+        for (EdgeLabel label = 0; label < labels.size(); ++label)
+            labels[label].forEachEdge([&](unsigned src, unsigned dst) { f(src, dst, label); });
+    }
+
+    /// Visit every edge of one label as (src, dst)
+    template<class F>
+    void forEachEdge(EdgeLabel label, F f) const
+    {
+        EdgeLabel stored = getStoredLabel(label);
+        if (stored >= labels.size())
+            return;
+        if (stored == label)
+            labels[label].forEachEdge(f);
+        else
+            labels[stored].forEachEdge([&](unsigned src, unsigned dst) { f(dst, src); });
+    }
+
+    /// One past the largest node ID that has a row in some label: this covers the source of
+    /// every edge whose label is kept Forward and the target of every other edge
+    unsigned getNodeNum() const;
+
+    /// Number of edges with a label
+    size_t getEdgeNum(EdgeLabel label) const
+    {
+        EdgeLabel stored = getStoredLabel(label);
+        return stored < labels.size() ? labels[stored].size() : 0;
+    }
+
+    /// Pack all adjacency rows; afterwards successors are visited in ascending order
+    void compact();
+
+    /// Pack the adjacency rows of one label
+    void compact(EdgeLabel label);
+
+    /**
+     * Make room for the labels [0, labelNum) up front. Afterwards adding edges with these
+     * labels never reallocates the label table, so threads may each insert into their own labels.
+     */
+    void reserveLabels(unsigned labelNum);
+
+    /**
+     * Split the rows of every label into shards by node ID (rounded up to a power of two),
+     * each with its own lock, so that insertIfAbsent may be called from several threads.
+     * One shard, the default, takes no locks.
+     */
+    void setShardNum(unsigned shardNum);
+
+    unsigned getShardNum() const
+    { return 1u << shardBits; }
+
+    /**
+     * Check if a node is an object node, i.e. the source of an Addr edge
+     * @param node the node to check
+     * @return true if the node is an object node, false otherwise
+     */
+    bool isObjectNode(unsigned node);
+    
+    /**
+     * Check if a node is a special node (like DummyObjVar)
+     * @param node the node to check
+     * @return true if the node is a special node, false otherwise
+     */
+    bool isSpecialNode(unsigned node);
+
+protected:
+    /// A test-and-set lock for short critical sections; copies start out unlocked
+    class SpinLock
+    {
+    public:
+        SpinLock() = default;
+
+        SpinLock(const SpinLock &)
+        {}
+
+        SpinLock &operator=(const SpinLock &)
+        { return *this; }
+
+        void lock()
+        {
+            while (flag.test_and_set(std::memory_order_acquire));
+        }
+
+        void unlock()
+        { flag.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag = ATOMIC_FLAG_INIT;
+    };
+
+    /// The rows of the nodes with the same low bits, in each kept direction
+    struct Shard
+    {
+        AdjacencyIndex succ;    // holding successors
+        AdjacencyIndex pred;    // holding predecessors
+        BitSetIndex succBits;   // holding successors in bitset storage
+        BitSetIndex predBits;   // holding predecessors in bitset storage
+        SpinLock lock;
+    };
+
+    /**
+     * The kept directions of the edges of one label, in one of the two storages.
+     * Node n is row n >> shardBits of shard n & (2^shardBits - 1).
+     * Membership and size are answered by the successors when they are kept, otherwise by
+     * the predecessors.
+     */
+    struct LabelIndex
+    {
+        LabelStorage storage = LabelStorage::Adjacency;
+        unsigned shardBits = 0;
+        unsigned directions = BothDirections;
+        std::vector<Shard> shards = std::vector<Shard>(1);
+
+        LabelIndex() = default;
+
+        LabelIndex(LabelStorage storage, unsigned shardBits, unsigned directions) :
+                storage(storage), shardBits(shardBits), directions(directions), shards(1u << shardBits)
+        {}
+
+        bool forward() const
+        { return directions & Forward; }
+
+        bool backward() const
+        { return directions & Backward; }
+
+        Shard &shardOf(unsigned node)
+        { return shards[node & (shards.size() - 1)]; }
+
+        const Shard &shardOf(unsigned node) const
+        { return shards[node & (shards.size() - 1)]; }
+
+        unsigned rowOf(unsigned node) const
+        { return node >> shardBits; }
+
+        bool contains(unsigned src, unsigned dst) const
+        {
+            if (!forward())
+            {
+                const Shard &shard = shardOf(dst);
+                return storage == LabelStorage::BitSet ? shard.predBits.contains(rowOf(dst), src)
+                                                       : shard.pred.contains(rowOf(dst), src);
+            }
+            const Shard &shard = shardOf(src);
+            return storage == LabelStorage::BitSet ? shard.succBits.contains(rowOf(src), dst)
+                                                   : shard.succ.contains(rowOf(src), dst);
+        }
+
+        /// Add src -> dst if absent, for a single thread
+        bool insert(unsigned src, unsigned dst);
+
+        /// Add src -> dst if absent, holding the lock of one shard at a time
+        bool insertLocked(unsigned src, unsigned dst);
+
+        /// Add dst to the successors of src if absent; does not touch the predecessors
+        bool insertSuccessor(unsigned src, unsigned dst);
+
+        /// Add src to the predecessors of dst if absent, for an index kept Backward only
+        bool insertPredecessor(unsigned dst, unsigned src);
+
+        /// Add src to the predecessors of dst, which must not hold it yet
+        void appendPredecessor(unsigned dst, unsigned src);
+
+        /// Remove src -> dst from the kept directions
+        bool erase(unsigned src, unsigned dst);
+
+        /// Move the edges over to another storage, shard count or set of directions
+        void reshape(LabelStorage newStorage, unsigned newShardBits, unsigned newDirections);
+
+        /// Fill an empty index with the distinct edges srcs[i] -> dsts[i] in one pass
+        void assign(const std::vector<unsigned> &srcs, const std::vector<unsigned> &dsts);
+
+        size_t size() const;
+
+        unsigned getNodeNum() const;
+
+        void compact();
+
+        template<class F>
+        void forEachSuccessor(unsigned src, F f) const
+        {
+            assert(forward() && "the successors of this label are not kept");
+            const Shard &shard = shardOf(src);
+            if (storage == LabelStorage::BitSet)
+                shard.succBits.forEach(rowOf(src), f);
+            else
+                shard.succ.forEach(rowOf(src), f);
+        }
+
+        template<class F>
+        void forEachPredecessor(unsigned dst, F f) const
+        {
+            assert(backward() && "the predecessors of this label are not kept");
+            const Shard &shard = shardOf(dst);
+            if (storage == LabelStorage::BitSet)
+                shard.predBits.forEach(rowOf(dst), f);
+            else
+                shard.pred.forEach(rowOf(dst), f);
+        }
+
+        /// Visit every edge as (src, dst) through the kept rows
+        template<class F>
+        void forEachEdge(F f) const
+        {
+            unsigned nodeNum = getNodeNum();
+            for (unsigned node = 0; node < nodeNum; ++node)
+            {
+                if (forward())
+                    forEachSuccessor(node, [&](unsigned dst) { f(node, dst); });
+                else
+                    forEachPredecessor(node, [&](unsigned src) { f(src, node); });
+            }
+        }
+    };
+
+    /// Add every statement with its Bar edge, each end replaced through nodeMap
+    void addStatements(const std::vector<CFLREdge> &stmts, const std::vector<unsigned> &nodeMap);
+
+    /// Make sure the labels [0, labelNum) exist, sharded like the rest of the graph
+    void growLabels(unsigned labelNum);
+
+    std::vector<LabelIndex> labels;     // indexed by label first, then by node
+    unsigned shardBits = 0;             // log2 of the number of shards per label
+    std::vector<EdgeLabel> storedLabels;    // see getStoredLabel
+    std::vector<EdgeLabel> reverseLabels;   // see getReverseLabel
+};
+
+
+/**
+ * FIFO worklist over a ring buffer.
+ * It does not filter duplicates: CFLR only pushes edges that were new to the graph, so the
+ * graph itself is the "already queued" flag of every edge.
+ */
+template<class T>
+class WorkList
+{
+public:
+    /// Check whether the worklist is empty.
+    inline bool empty() const
+    { return head == tail; }
+
+    inline size_t size() const
+    { return tail - head; }
+
+    /// Clear the worklist
+    inline void clear()
+    { head = tail = 0; }
+
+    /// Push a data into the END work list.
+    inline bool push(const T &data)
+    {
+        if (size() == ring.size())
+            grow();
+        ring[tail++ & (ring.size() - 1)] = data;
+        return true;
+    }
+
+    /// Pop a data from the FRONT of work list.
+    inline T pop()
+    {
+        assert(!this->empty() && "work list is empty");
+        return ring[head++ & (ring.size() - 1)];
+    }
+
+    /// Pop a data from the END of work list.
+    inline T popBack()
+    {
+        assert(!this->empty() && "work list is empty");
+        return ring[--tail & (ring.size() - 1)];
+    }
+
+    /// Visit the queued data from front to end without popping them
+    template<class F>
+    void forEach(F f) const
+    {
+        for (size_t i = head; i != tail; ++i)
+            f(ring[i & (ring.size() - 1)]);
+    }
+
+protected:
+    /// Double the ring, unwrapping its content to the front
+    void grow()
+    {
+        std::vector<T> bigger(ring.empty() ? 64 : ring.size() * 2);
+        for (size_t i = head; i != tail; ++i)
+            bigger[i - head] = ring[i & (ring.size() - 1)];
+        tail -= head;
+        head = 0;
+        ring.swap(bigger);
+    }
+
+    std::vector<T> ring;    ///< capacity is a power of two
+    size_t head = 0;        ///< position of the front, grows without wrapping
+    size_t tail = 0;        ///< position past the end, grows without wrapping
+};
+
+
+/// The order in which CFLR::solve joins the queued edges
+enum class WorkOrder
+{
+    Fifo,           // in the order the edges were derived
+    Lifo,           // the newest edge first, while the rows it touched are still in cache
+    PerLabel,       // one queue per label, drained label by label in turn
+    LabelPriority,  // one queue per label rank, always the lowest rank first
+    Topological,    // by the rank of the source node, lowest first
+};
+
+/// Parse "fifo", "lifo", "per-label", "label-priority" or "topological"; false for an unknown name
+bool parseWorkOrder(const std::string &name, WorkOrder &order);
+
+
+/**
+ * The worklist of CFLR, in one of the orders of WorkOrder. The FIFO and LIFO orders keep
+ * one queue; the others keep a FIFO queue per key (a label, a label rank or a bucket of node
+ * ranks), so that edges with the same key come in batches.
+ */
+class EdgeWorkList
+{
+public:
+    /// Number of queues the node ranks of WorkOrder::Topological are spread over
+    static constexpr unsigned NodeBuckets = 1024;
+
+    /// Choose the order of the queued edges; the worklist must be empty
+    void setOrder(WorkOrder workOrder)
+    {
+        assert(empty() && "cannot change the order of a non-empty worklist");
+        order = workOrder;
+        current = 0;
+    }
+
+    WorkOrder getOrder() const
+    { return order; }
+
+    /// The rank of every label for WorkOrder::LabelPriority; labels past the end come last
+    void setLabelRanks(std::vector<unsigned> ranks)
+    {
+        assert(empty() && "cannot rank the labels of a non-empty worklist");
+        labelRanks = std::move(ranks);
+    }
+
+    /// The rank of every node for WorkOrder::Topological, grouped into NodeBuckets queues;
+    /// nodes past the end come last
+    void setNodeRanks(const std::vector<unsigned> &ranks)
+    {
+        assert(empty() && "cannot rank the nodes of a non-empty worklist");
+        unsigned rankNum = 0;
+        for (unsigned rank : ranks)
+            rankNum = std::max(rankNum, rank + 1);
+        nodeBuckets.resize(ranks.size());
+        for (size_t node = 0; node < ranks.size(); ++node)
+            nodeBuckets[node] = (uint64_t) ranks[node] * NodeBuckets / rankNum;
+    }
+
+    inline bool empty() const
+    { return num == 0; }
+
+    inline size_t size() const
+    { return num; }
+
+    inline void clear()
+    {
+        fifo.clear();
+        for (auto &queue : queues)
+            queue.clear();
+        num = 0;
+    }
+
+    inline void push(const CFLREdge &edge)
+    {
+        ++num;
+        if (order == WorkOrder::Fifo || order == WorkOrder::Lifo)
+        {
+            fifo.push(edge);
+            return;
+        }
+        size_t key = keyOf(edge);
+        if (key >= queues.size())
+            queues.resize(key + 1);
+        queues[key].push(edge);
+        // A new edge may rank before the queue being drained
+        if (order != WorkOrder::PerLabel && key < current)
+            current = key;
+    }
+
+    inline CFLREdge pop()
+    {
+        assert(!empty() && "work list is empty");
+        --num;
+        if (order == WorkOrder::Fifo)
+            return fifo.pop();
+        if (order == WorkOrder::Lifo)
+            return fifo.popBack();
+        if (order == WorkOrder::PerLabel)
+        {
+            while (queues[current].empty())
+                current = (current + 1) % queues.size();
+            return queues[current].pop();
+        }
+        while (queues[current].empty())
+            ++current;
+        return queues[current].pop();
+    }
+
+    /// Visit the queued edges without popping them
+    template<class F>
+    void forEach(F f) const
+    {
+        fifo.forEach(f);
+        for (const auto &queue : queues)
+            queue.forEach(f);
+    }
+
+private:
+    /// The queue of an edge in the orders with several queues
+    inline size_t keyOf(const CFLREdge &edge) const
+    {
+        if (order == WorkOrder::LabelPriority)
+            return edge.label < labelRanks.size() ? labelRanks[edge.label] : labelRanks.size();
+        if (order == WorkOrder::Topological)
+            return edge.src < nodeBuckets.size() ? nodeBuckets[edge.src] : NodeBuckets;
+        return edge.label;
+    }
+
+    WorkOrder order = WorkOrder::Fifo;
+    WorkList<CFLREdge> fifo;
+    std::vector<WorkList<CFLREdge>> queues;
+    std::vector<unsigned> labelRanks;
+    std::vector<unsigned> nodeBuckets;
+    size_t current = 0;     ///< the queue being drained
+    size_t num = 0;
+};
+
+
+/**
+ * CFL-reachability implementation
+ */
+class CFLR
+{
+    EdgeWorkList workList;
+    CFLRGraph *graph;
+    CFLGrammar grammar;
+    bool ruleKernels = false;       // grammar is the one compiled into PointsToKernels
+    std::vector<unsigned> nbrs;     // scratch buffer for joins
+
+    WorkList<std::pair<unsigned, EdgeLabel>> demandList;    // demands not expanded yet
+    std::vector<std::vector<bool>> demanded;    // demanded[A][x]: every x -A-> w is needed
+
+    bool isDemanded(EdgeLabel label, unsigned node) const
+    { return label < demanded.size() && node < demanded[label].size() && demanded[label][node]; }
+
+    /// Ask for the label-successors of node, queueing the demand if it is new
+    void demand(unsigned node, EdgeLabel label);
+    /// Pass a new demand down to the operands of the rules with its label as head
+    void expandDemand(unsigned x, EdgeLabel A);
+    /// Join a new edge through the rules whose head is demanded at the joined source
+    void applyDemandedRules(const CFLREdge &edge);
+
+    bool mappedOutput = false;      // dumpResult() maps the result file instead of writing it
+    bool textOutput = true;         // dumpResult() writes <module>.res.txt
+    bool binaryOutput = false;      // dumpResult() writes <module>.res.bin (see PointsToFile.h)
+    std::string resultName;         // base name of the result files, the module by default
+    bool substitution = false;      // run VariableSubstitution before building the graph
+    std::vector<unsigned> nodeMap;  // the graph node of every PAG node, when substituted
+    bool cycleCollapsing = false;   // merge the nodes of VF cycles while solving
+    UnionFind nodeReps;             // representative of every merged node
+
+    /// The node of the graph that holds the facts of a PAG node
+    unsigned getGraphNode(unsigned node)
+    { return nodeReps.find(node < nodeMap.size() ? nodeMap[node] : node); }
+    std::vector<std::pair<unsigned, unsigned>> pendingMerges;   // VF cycles found, not merged yet
+
+    /// Merge two nodes of a VF cycle, moving the edges of the absorbed one onto the representative
+    void mergeNodes(unsigned x, unsigned y);
+    /// Find the SCCs of the Copy edges with Tarjan's algorithm and merge each into one node
+    void collapseCopyCycles();
+
+    static constexpr unsigned NoSCC = ~0u;
+    /**
+     * Tarjan's algorithm over the Copy edges between the nodes below nodeNum
+     * @param skip nodes left out of every SCC, none if empty
+     * @param sccNum receives the number of SCCs
+     * @return the SCC of every node, numbered as they complete, so an SCC comes after every
+     *         SCC it copies to; NoSCC for the skipped nodes
+     */
+    std::vector<unsigned> findCopySCCs(unsigned nodeNum, const std::vector<bool> &skip, unsigned &sccNum);
+    /// Rank the labels for WorkOrder::LabelPriority: 0 for the bodies of unary rules and the
+    /// operands of closure rules, 1 for the other labels
+    std::vector<unsigned> rankLabels() const;
+    /// Rank the nodes for WorkOrder::Topological by the SCCs of Copy, sources first
+    std::vector<unsigned> rankNodes();
+
+    std::string snapshotFile;           // where solving saves its state, empty for nowhere
+    unsigned checkpointInterval = 0;    // seconds between snapshots while solving, 0 for none
+    std::chrono::steady_clock::time_point lastCheckpoint;
+    uint64_t inputKey = 0;              // hash of the initial graph and the grammar
+    bool solved = false;                // the graph holds the fixed point
+    bool resuming = false;              // solving starts from pendingEdges, not from every edge
+    std::vector<CFLREdge> pendingEdges; // edges of a loaded snapshot not joined yet
+
+    unsigned timeBudget = 0;            // seconds a solving call may run, 0 for no limit
+    unsigned memoryBudget = 0;          // MiB of resident memory solving may use, 0 for no limit
+    unsigned progressInterval = 0;      // seconds between progress lines, 0 for none
+    std::chrono::steady_clock::time_point solveStart, lastProgress;
+    size_t lastProgressEdges = 0;
+    std::string stopReason;             // the budget the last solving call stopped at, empty if none
+
+    /**
+     * Keep for every label only the adjacency directions the solver probes: the successors of
+     * C and the predecessors of B for every A ::= B C, and the successors of PT for the
+     * results. Demand-driven solving and DRed rederivation also walk B forward, demand-driven
+     * solving walks unary bodies forward, and merging nodes moves edges both ways.
+     */
+    void layOutLabels(bool demandDriven, bool rederiving);
+
+    /**
+     * Join the queued edges until the worklist runs dry
+     * @return false if a budget stopped it first, see stopAtBudget
+     */
+    bool propagate();
+
+    /// Start the clock of the budgets and the progress lines for a solving call
+    void startBudget();
+    /// Print a progress line when one is due and check the budgets, setting stopReason
+    /// once one is used up
+    bool budgetExhausted(size_t pendingNum);
+    /// Keep the edges not joined yet for the next solving call, as a loaded snapshot does,
+    /// and save them to snapshotFile if there is one
+    void stopAtBudget(std::vector<CFLREdge> &pending);
+    /// Number of edges of all labels
+    size_t countEdges() const;
+
+    /// FNV-1a hash of the grammar and every edge of the graph
+    uint64_t hashInput() const;
+    /// Whether checkpointInterval has passed since the last snapshot
+    bool checkpointDue();
+    /**
+     * Write the graph, the merged nodes and the edges still to be joined to snapshotFile,
+     * through a temporary file that replaces it once complete
+     * @param complete whether the graph holds the fixed point, pending is empty then
+     */
+    void saveSnapshot(const std::vector<CFLREdge> &pending, bool complete);
+    /// Replace the graph with the one in snapshotFile if it was saved for inputKey
+    bool loadSnapshot();
+
+    /// Write the points-to sets of srcs, in ascending order, as text lines or as a PointsToFile
+    void dumpText(const std::string &fname, const std::vector<unsigned> &srcs);
+    void dumpBinary(const std::string &fname, const std::vector<unsigned> &srcs);
+
+    CFLR_STAT(SolverStats stats;)
+
+public:
+    CFLR() : graph(nullptr)
+    { setGrammar(CFLGrammar::pointsTo()); }
+
+    ~CFLR()
+    { delete graph; }
+
+    /// Build a graph from PAG
+    void buildGraph(SVF::PAG *pag);
+    /// Build a graph from statements, see CFLRGraph(const std::vector<CFLREdge> &, ...)
+    void buildGraph(const std::vector<CFLREdge> &stmts);
+
+    const CFLRGraph *getGraph() const
+    { return graph; }
+
+    /**
+     * Merge pointer-equivalent PAG nodes with VariableSubstitution before buildGraph, so the
+     * graph is built over one node per value number; dumpResult() and query() map the PAG
+     * nodes back through the table.
+     * @return false, changing nothing, if the grammar is not CFLGrammar::pointsTo()
+     */
+    bool useVariableSubstitution();
+
+    /// Replace the points-to grammar; it is solved in binary normal form
+    void setGrammar(const CFLGrammar &g);
+
+    const CFLGrammar &getGrammar() const
+    { return grammar; }
+
+    /// Store the closure labels (VF, VFBar, VA, PT) as sparse bitsets, so that their
+    /// productions are solved by word-parallel unions. Call after buildGraph.
+    void useClosureBitSets();
+
+    /**
+     * Store every Bar label pair once: AddrBar, CopyBar, StoreBar, LoadBar, PTBar, SVBar and
+     * VFBar are served from the reverse index of their base label (see CFLRGraph::mirrorLabel).
+     * A derived edge is queued once for both labels, and joined as both when popped.
+     * Call after buildGraph.
+     * @return false, changing nothing, if the grammar is not CFLGrammar::pointsTo()
+     */
+    bool useBarSymmetry();
+
+    /// Queue edges per label and drain one label at a time
+    void useLabelQueues()
+    { setWorkOrder(WorkOrder::PerLabel); }
+
+    /**
+     * Choose the order in which solve() joins the queued edges. For LabelPriority, the bodies
+     * of unary rules and the operands of closure rules (A ::= A B or A ::= B A) come before
+     * the other join operands, such as the Store and Load joins of the points-to grammar. For
+     * Topological, edges go by the rank of their source in the DAG of the SCCs of Copy,
+     * sources first, so facts flow down copy chains before they are joined further.
+     * The ranks are taken when solve() starts; the semi-naive solver has no worklist.
+     */
+    void setWorkOrder(WorkOrder order)
+    { workList.setOrder(order); }
+
+    /**
+     * Let solve() merge pointers that lie on a VF cycle, since they have the same points-to
+     * set: the SCCs of Copy are merged before solving, and two nodes are merged as soon as
+     * VF holds both ways between them. Objects are never merged. dumpResult() prints every
+     * merged node with the points-to set of its representative.
+     * @return false, changing nothing, if the grammar is not CFLGrammar::pointsTo()
+     */
+    bool useCycleCollapsing();
+
+    /// Add an edge to the graph and the worklist, unless the graph already has it
+    void addEdgeToWorklist(unsigned src, unsigned dst, EdgeLabel label);
+    /// A ::= B with x -B-> z: add x -A-> z
+    inline void applyUnaryRule(unsigned x, unsigned z, [[maybe_unused]] EdgeLabel B, EdgeLabel A)
+    {
+        CFLR_STAT(uint64_t derived = stats.getDerived());
+        addEdgeToWorklist(x, z, A);
+        CFLR_STAT(stats.countJoin(A, B, SolverStats::NoRight, 1, stats.getDerived() - derived));
+    }
+    /// Join a new edge with the graph through every rule it is an operand of
+    void applyProductionRules(const CFLREdge& edge);
+    /// Join a popped edge, and its reverse along the label mirrored onto its own (see useBarSymmetry)
+    void joinEdge(const CFLREdge &edge);
+
+    /// A ::= B C with x -B-> z: add x -A-> w for every z -C-> w
+    void joinSuccessors(unsigned x, unsigned z, EdgeLabel C, EdgeLabel A);
+    /// A ::= B C with x -C-> z: add y -A-> z for every y -B-> x
+    void joinPredecessors(unsigned x, unsigned z, EdgeLabel B, EdgeLabel A);
+    
+    /// The dynamic-programming CFL-reachability algorithm.
+    void solve();
+    /**
+     * Add PAG edges, labelled Addr, Copy, Store or Load, together with their Bar edges.
+     * On a solved graph only the new edges are queued and the fixed point is carried on
+     * from there, so the work follows the size of the change.
+     * @return false, changing nothing, with VariableSubstitution or after query()
+     */
+    bool addPAGEdges(const std::vector<CFLREdge> &edges);
+    /**
+     * Remove PAG edges, as for addPAGEdges, and retract what no longer follows (DRed):
+     * every edge with a derivation through a removed one is deleted first, then the deleted
+     * edges that still have a derivation in what is left are derived again.
+     * Graph edges are sets, so an edge goes however many PAG statements produced it: removing
+     * one of two identical statements removes both, and the survivor has to be added back.
+     * The result is that of solving the program with every copy of the edges removed.
+     * @return false, changing nothing, with VariableSubstitution, cycle collapsing, after query(),
+     *         or when solving stopped at a budget or is still to resume from a snapshot
+     */
+    bool removePAGEdges(const std::vector<CFLREdge> &edges);
+    /**
+     * The same fixed point, evaluated semi-naively in rounds: the edges new in one round are
+     * joined set-at-a-time against the whole graph, grouped by their join node, and the
+     * edges they derive are inserted in bulk to form the next round.
+     *
+     * With several threads, the joins of a round are split into chunks of each label's delta
+     * and balanced over per-thread work-stealing deques while the graph is only read; the
+     * graph is then sharded by node and every thread inserts what it derived through
+     * insertIfAbsent. Rounds and their results are the same for any number of threads.
+     */
+    void solveSemiNaive(unsigned threadNum = 1);
+    /**
+     * Demand-driven solving: derive every node -label-> w (the points-to set of node by
+     * default) and only the edges it depends on. Demands propagate from a rule's head to its
+     * operands, so x -A-> w is derived only once the A-successors of x are demanded.
+     * Demands and derived edges are kept, so later queries reuse the work of earlier ones.
+     * Not to be mixed with solve() or solveSemiNaive() on the same graph.
+     */
+    void query(unsigned node, EdgeLabel label = PT);
+    /**
+     * Keep the state of the solver in a snapshot file. Call after buildGraph: a snapshot
+     * saved for the same initial graph and grammar is loaded in place of the graph. If it
+     * holds the fixed point, solving and queries return at once; if it was saved while
+     * solving, solve() and solveSemiNaive() go on from the edges it left pending. Both save
+     * the fixed point when done, and a snapshot of their progress every checkpointSeconds.
+     * @return true if a snapshot was loaded
+     */
+    bool useSnapshot(const std::string &fname, unsigned checkpointSeconds = 0);
+
+    /// Whether the graph holds the fixed point, solved or loaded
+    bool isSolved() const
+    { return solved; }
+
+    /// Let dumpResult() size the result file up front and fill it through a memory mapping
+    void useMappedOutput()
+    { mappedOutput = true; }
+
+    /// Choose the result files dumpResult() writes: the text lines, the binary points-to file, or both
+    void setOutputFormats(bool text, bool binary)
+    {
+        textOutput = text;
+        binaryOutput = binary;
+    }
+
+    /// Name the result files <name>.res.txt and so on, instead of after the module of the PAG
+    void setResultName(const std::string &name)
+    { resultName = name; }
+
+    /**
+     * Write the counters and timers of the run, see SolverStats.h
+     * @param format "json" or "csv"
+     * @return false if the file cannot be written, or the statistics are compiled out
+     */
+    bool writeStats(const std::string &fname, const std::string &format) const;
+    /// Sample the progress of solving every ms milliseconds into the statistics
+    void setStatsInterval(unsigned ms);
+
+    CFLR_STAT(const SolverStats &getStats() const
+              { return stats; })
+
+    /**
+     * Stop solve() and solveSemiNaive() once a call has run for seconds, or the process holds
+     * megabytes of resident memory (0 for no limit). Every edge derived by then holds, so
+     * dumpResult() writes points-to sets that are subsets of the fixed point, marked as
+     * incomplete. The edges not joined yet are kept, and saved to the snapshot if there is
+     * one, so that calling solve() again carries on from there. solveSemiNaive() checks the
+     * budgets between rounds only.
+     */
+    void setBudget(unsigned seconds, unsigned megabytes)
+    {
+        timeBudget = seconds;
+        memoryBudget = megabytes;
+    }
+
+    /// Print a line on the progress of solving every seconds, 0 for none
+    void setProgressInterval(unsigned seconds)
+    { progressInterval = seconds; }
+
+    /// Whether the last solving call reached the fixed point rather than a budget
+    bool isComplete() const
+    { return stopReason.empty(); }
+
+    /// Dump results into a file
+    void dumpResult();
+    /// Dump the points-to sets of some nodes only
+    void dumpResult(const std::vector<unsigned> &nodes);
+};
+
+#endif //ANSWERS_A4HEADER_H
@@ -5,127 +5,643 @@
 
 #include "A4Header.h"
 
-CFLRGraph::CFLRGraph(SVF::SVFIR *pag)
+#include <algorithm>
+#include <mutex>
+
+CFLRGraph::CFLRGraph(SVF::SVFIR *pag, const std::vector<unsigned> &nodeMap)
 {
+    // Gather the statements first, then lay out each label at once
+    std::vector<CFLREdge> stmts;
+    size_t stmtNum = 0;
+    for (auto kind : {SVF::PAGEdge::Addr, SVF::PAGEdge::Copy, SVF::PAGEdge::Phi, SVF::PAGEdge::Select,
+                      SVF::PAGEdge::Call, SVF::PAGEdge::Ret, SVF::PAGEdge::ThreadFork,
+                      SVF::PAGEdge::ThreadJoin, SVF::PAGEdge::Store, SVF::PAGEdge::Load})
+        stmtNum += pag->getSVFStmtSet(kind).size();
+    stmts.reserve(stmtNum);
+
     for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Addr))
-    {
-        addEdge(edge->getSrcID(), edge->getDstID(), Addr);
-        addEdge(edge->getDstID(), edge->getSrcID(), AddrBar);
-    }
+        stmts.emplace_back(edge->getSrcID(), edge->getDstID(), Addr);
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Copy))
+    for (auto kind : {SVF::PAGEdge::Copy, SVF::PAGEdge::Call, SVF::PAGEdge::Ret,
+                      SVF::PAGEdge::ThreadFork, SVF::PAGEdge::ThreadJoin})
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        for (SVF::PAGEdge *edge : pag->getSVFStmtSet(kind))
+            stmts.emplace_back(edge->getSrcID(), edge->getDstID(), Copy);
     }
 
     for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Phi))
     {
         const SVF::PhiStmt *phi = SVF::SVFUtil::cast<SVF::PhiStmt>(edge);
         for (const auto opVar : phi->getOpndVars())
-        {
-            addEdge(opVar->getId(), phi->getResID(), Copy);
-            addEdge(phi->getResID(), opVar->getId(), CopyBar);
-        }
+            stmts.emplace_back(opVar->getId(), phi->getResID(), Copy);
     }
 
     for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Select))
     {
         const SVF::SelectStmt *sel = SVF::SVFUtil::cast<SVF::SelectStmt>(edge);
         for (const auto opVar : sel->getOpndVars())
+            stmts.emplace_back(opVar->getId(), sel->getResID(), Copy);
+    }
+
+    // opt load and store
+    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Store))
+        stmts.emplace_back(edge->getSrcID(), edge->getDstID(), Store);
+    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Load))
+        stmts.emplace_back(edge->getSrcID(), edge->getDstID(), Load);
+
+    addStatements(stmts, nodeMap);
+}
+
+
+CFLRGraph::CFLRGraph(const std::vector<CFLREdge> &stmts, const std::vector<unsigned> &nodeMap)
+{
+    addStatements(stmts, nodeMap);
+}
+
+
+void CFLRGraph::addStatements(const std::vector<CFLREdge> &stmts, const std::vector<unsigned> &nodeMap)
+{
+    auto rep = [&](unsigned node) { return node < nodeMap.size() ? nodeMap[node] : node; };
+    std::vector<CFLREdge> edges;
+    edges.reserve(2 * stmts.size());
+    for (const CFLREdge &stmt : stmts)
+    {
+        edges.emplace_back(rep(stmt.src), rep(stmt.dst), stmt.label);
+        edges.emplace_back(rep(stmt.dst), rep(stmt.src), stmt.label + 1);
+    }
+    addEdges(edges);
+}
+
+
+void CFLRGraph::addEdges(std::vector<CFLREdge> &edges)
+{
+    std::sort(edges.begin(), edges.end(), [](const CFLREdge &a, const CFLREdge &b) {
+        if (a.label != b.label)
+            return a.label < b.label;
+        return a.src != b.src ? a.src < b.src : a.dst < b.dst;
+    });
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    std::vector<unsigned> srcs, dsts;
+    for (size_t first = 0, last; first < edges.size(); first = last)
+    {
+        EdgeLabel label = edges[first].label;
+        for (last = first; last < edges.size() && edges[last].label == label; ++last);
+        growLabels(label + 1);
+        LabelIndex &index = labels[label];
+        if (getStoredLabel(label) != label || index.size() || index.storage != LabelStorage::Adjacency || shardBits)
         {
-            addEdge(opVar->getId(), sel->getResID(), Copy);
-            addEdge(sel->getResID(), opVar->getId(), CopyBar);
+            for (size_t i = first; i < last; ++i)
+                insertIfAbsent(edges[i].src, edges[i].dst, label);
+            continue;
         }
+        srcs.clear();
+        dsts.clear();
+        for (size_t i = first; i < last; ++i)
+        {
+            srcs.push_back(edges[i].src);
+            dsts.push_back(edges[i].dst);
+        }
+        index.assign(srcs, dsts);
     }
+}
+
+
+bool CFLRGraph::LabelIndex::insert(unsigned int src, unsigned int dst)
+{
+    if (!forward())
+        return insertPredecessor(dst, src);
+    if (!insertSuccessor(src, dst))
+        return false;
+    if (backward())
+        appendPredecessor(dst, src);
+    return true;
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Call))
+
+bool CFLRGraph::LabelIndex::insertLocked(unsigned int src, unsigned int dst)
+{
+    if (!forward())
+    {
+        std::lock_guard<SpinLock> guard(shardOf(dst).lock);
+        return insertPredecessor(dst, src);
+    }
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        std::lock_guard<SpinLock> guard(shardOf(src).lock);
+        if (!insertSuccessor(src, dst))
+            return false;
     }
+    if (backward())
+    {
+        std::lock_guard<SpinLock> guard(shardOf(dst).lock);
+        appendPredecessor(dst, src);
+    }
+    return true;
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Ret))
+
+bool CFLRGraph::LabelIndex::insertSuccessor(unsigned int src, unsigned int dst)
+{
+    Shard &shard = shardOf(src);
+    return storage == LabelStorage::BitSet ? shard.succBits.insert(rowOf(src), dst)
+                                           : shard.succ.insert(rowOf(src), dst);
+}
+
+
+bool CFLRGraph::LabelIndex::insertPredecessor(unsigned int dst, unsigned int src)
+{
+    Shard &shard = shardOf(dst);
+    return storage == LabelStorage::BitSet ? shard.predBits.insert(rowOf(dst), src)
+                                           : shard.pred.insert(rowOf(dst), src);
+}
+
+
+void CFLRGraph::LabelIndex::appendPredecessor(unsigned int dst, unsigned int src)
+{
+    Shard &shard = shardOf(dst);
+    if (storage == LabelStorage::BitSet)
+        shard.predBits.insert(rowOf(dst), src);
+    else
+        shard.pred.append(rowOf(dst), src);
+}
+
+
+bool CFLRGraph::LabelIndex::erase(unsigned int src, unsigned int dst)
+{
+    Shard &from = shardOf(src), &to = shardOf(dst);
+    bool found = true;
+    if (forward())
+        found = storage == LabelStorage::BitSet ? from.succBits.erase(rowOf(src), dst)
+                                                : from.succ.erase(rowOf(src), dst);
+    if (found && backward())
+        found = storage == LabelStorage::BitSet ? to.predBits.erase(rowOf(dst), src)
+                                                : to.pred.erase(rowOf(dst), src);
+    return found;
+}
+
+
+void CFLRGraph::LabelIndex::reshape(LabelStorage newStorage, unsigned int newShardBits, unsigned newDirections)
+{
+    if (storage == newStorage && shardBits == newShardBits && directions == newDirections)
+        return;
+    // Dropping a direction needs no copy
+    if (storage == newStorage && shardBits == newShardBits && (newDirections & ~directions) == 0)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        for (Shard &shard : shards)
+        {
+            if (!(newDirections & Forward))
+            {
+                shard.succ = AdjacencyIndex();
+                shard.succBits = BitSetIndex();
+            }
+            if (!(newDirections & Backward))
+            {
+                shard.pred = AdjacencyIndex();
+                shard.predBits = BitSetIndex();
+            }
+        }
+        directions = newDirections;
+        return;
     }
+    LabelIndex moved(newStorage, newShardBits, newDirections);
+    forEachEdge([&](unsigned src, unsigned dst) { moved.insert(src, dst); });
+    *this = std::move(moved);
+}
+
+
+void CFLRGraph::LabelIndex::assign(const std::vector<unsigned int> &srcs, const std::vector<unsigned int> &dsts)
+{
+    assert(storage == LabelStorage::Adjacency && shards.size() == 1 && "only a plain index is laid out at once");
+    if (forward())
+        shards[0].succ.assign(srcs, dsts);
+    if (backward())
+        shards[0].pred.assign(dsts, srcs);
+}
+
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::ThreadFork))
+size_t CFLRGraph::LabelIndex::size() const
+{
+    size_t num = 0;
+    for (const Shard &shard : shards)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        if (storage == LabelStorage::BitSet)
+            num += forward() ? shard.succBits.size() : shard.predBits.size();
+        else
+            num += forward() ? shard.succ.size() : shard.pred.size();
     }
+    return num;
+}
 
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::ThreadJoin))
+
+unsigned CFLRGraph::LabelIndex::getNodeNum() const
+{
+    unsigned nodeNum = 0;
+    for (unsigned i = 0; i < shards.size(); ++i)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Copy);
-        addEdge(edge->getDstID(), edge->getSrcID(), CopyBar);
+        const Shard &shard = shards[i];
+        unsigned rowNum;
+        if (storage == LabelStorage::BitSet)
+            rowNum = forward() ? shard.succBits.getNodeNum() : shard.predBits.getNodeNum();
+        else
+            rowNum = forward() ? shard.succ.getNodeNum() : shard.pred.getNodeNum();
+        if (rowNum)
+            nodeNum = std::max(nodeNum, (((rowNum - 1) << shardBits) | i) + 1);
     }
+    return nodeNum;
+}
 
-    // opt load and store
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Store))
+
+void CFLRGraph::LabelIndex::compact()
+{
+    for (Shard &shard : shards)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Store);
-        addEdge(edge->getDstID(), edge->getSrcID(), StoreBar);
+        shard.succ.compact();
+        shard.pred.compact();
     }
-    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Load))
+}
+
+
+bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel label) const
+{
+    if (getStoredLabel(label) != label)
+        return hasEdge(dst, src, getStoredLabel(label));
+    return label < labels.size() && labels[label].contains(src, dst);
+}
+
+
+bool CFLRGraph::insertIfAbsent(unsigned int src, unsigned int dst, EdgeLabel label)
+{
+    if (getStoredLabel(label) != label)
+        return insertIfAbsent(dst, src, getStoredLabel(label));
+    if (shardBits == 0)
     {
-        addEdge(edge->getSrcID(), edge->getDstID(), Load);
-        addEdge(edge->getDstID(), edge->getSrcID(), LoadBar);
+        growLabels(label + 1);
+        return labels[label].insert(src, dst);
     }
+    assert(label < labels.size() && "reserve the labels before inserting into a sharded graph");
+    return labels[label].insertLocked(src, dst);
 }
 
 
-bool CFLRGraph::hasEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+bool CFLRGraph::removeEdge(unsigned int src, unsigned int dst, EdgeLabel label)
 {
-    return succMap[src][EdgeLabel].count(dst);
+    if (getStoredLabel(label) != label)
+        return removeEdge(dst, src, getStoredLabel(label));
+    return label < labels.size() && labels[label].erase(src, dst);
 }
 
 
-void CFLRGraph::addEdge(unsigned int src, unsigned int dst, EdgeLabel EdgeLabel)
+bool CFLRGraph::unionSuccessors(unsigned int dst, EdgeLabel dstLabel, unsigned int src, EdgeLabel srcLabel,
+                                std::vector<unsigned> &added)
 {
-    succMap[src][EdgeLabel].insert(dst);
-    predMap[dst][EdgeLabel].insert(src);
+    if (getLabelStorage(dstLabel) != LabelStorage::BitSet || getLabelStorage(srcLabel) != LabelStorage::BitSet ||
+        getStoredLabel(dstLabel) != dstLabel || getStoredLabel(srcLabel) != srcLabel)
+        return false;
+    LabelIndex &to = labels[dstLabel];
+    const LabelIndex &from = labels[srcLabel];
+    if (!to.forward() || !from.forward())
+        return false;
+    size_t first = added.size();
+    to.shardOf(dst).succBits.unionRow(to.rowOf(dst), from.shardOf(src).succBits, from.rowOf(src), added);
+    for (size_t i = first; to.backward() && i < added.size(); ++i)
+        to.shardOf(added[i]).predBits.insert(to.rowOf(added[i]), dst);
+    return true;
 }
 
 
-void CFLR::buildGraph(SVF::PAG *pag)
+void CFLRGraph::setLabelStorage(EdgeLabel label, LabelStorage storage)
 {
-    if (!graph)
-        graph = new CFLRGraph(pag);
+    label = getStoredLabel(label);
+    growLabels(label + 1);
+    labels[label].reshape(storage, shardBits, labels[label].directions);
 }
 
 
-void CFLR::dumpResult()
+void CFLRGraph::setLabelDirections(EdgeLabel label, unsigned int directions)
 {
-    std::string fname = SVF::PAG::getPAG()->getModuleIdentifier() + ".res.txt";
-    std::ofstream outFile(fname, std::ios::out);
-    if (!outFile)
+    if (getStoredLabel(label) != label)
     {
-        std::cout << "error opening " + fname + "!!\n";
+        setLabelDirections(getStoredLabel(label), reverseDirections(directions));
         return;
     }
+    growLabels(label + 1);
+    labels[label].reshape(labels[label].storage, shardBits, directions ? directions : Forward);
+}
+
 
-    // Collect S-edges
-    std::map<unsigned, std::set<unsigned >> edgeSet;  // ordered edge set
-    for (auto &nodeItr : graph->getSuccessorMap())
+void CFLRGraph::mirrorLabel(EdgeLabel bar, EdgeLabel label)
+{
+    assert(bar != label && getStoredLabel(label) == label && getReverseLabel(label) == label &&
+           getStoredLabel(bar) == bar && getReverseLabel(bar) == bar && "each label is mirrored at most once");
+    growLabels(std::max(bar, label) + 1);
+    // Fold the edges bar has so far into label, then free the index of bar
+    LabelIndex &from = labels[bar];
+    from.forEachEdge([&](unsigned src, unsigned dst) { labels[label].insert(dst, src); });
+    from = LabelIndex(from.storage, shardBits, from.directions);
+    storedLabels[bar] = label;
+    reverseLabels[bar] = label;
+    reverseLabels[label] = bar;
+}
+
+
+std::unordered_set<unsigned> CFLRGraph::getSuccessors(unsigned int src, EdgeLabel label) const
+{
+    std::vector<unsigned> succs;
+    collectSuccessors(src, label, succs);
+    return std::unordered_set<unsigned>(succs.begin(), succs.end());
+}
+
+
+std::unordered_set<unsigned> CFLRGraph::getPredecessors(unsigned int dst, EdgeLabel label) const
+{
+    std::vector<unsigned> preds;
+    collectPredecessors(dst, label, preds);
+    return std::unordered_set<unsigned>(preds.begin(), preds.end());
+}
+
+
+void CFLRGraph::collectSuccessors(unsigned int src, EdgeLabel label, std::vector<unsigned> &out) const
+{
+    // The successors along a mirrored label are the predecessors along its stored label
+    EdgeLabel stored = getStoredLabel(label);
+    if (stored >= labels.size())
+        return;
+    if (stored == label)
+        labels[label].forEachSuccessor(src, [&](unsigned dst) { out.push_back(dst); });
+    else
+        labels[stored].forEachPredecessor(src, [&](unsigned dst) { out.push_back(dst); });
+}
+
+
+void CFLRGraph::collectPredecessors(unsigned int dst, EdgeLabel label, std::vector<unsigned> &out) const
+{
+    EdgeLabel stored = getStoredLabel(label);
+    if (stored >= labels.size())
+        return;
+    if (stored == label)
+        labels[label].forEachPredecessor(dst, [&](unsigned src) { out.push_back(src); });
+    else
+        labels[stored].forEachSuccessor(dst, [&](unsigned src) { out.push_back(src); });
+}
+
+
+unsigned CFLRGraph::getNodeNum() const
+{
+    unsigned nodeNum = 0;
+    for (const LabelIndex &index : labels)
+        nodeNum = std::max(nodeNum, index.getNodeNum());
+    return nodeNum;
+}
+
+
+void CFLRGraph::compact()
+{
+    for (EdgeLabel label = 0; label < labels.size(); ++label)
+        compact(label);
+}
+
+
+void CFLRGraph::compact(EdgeLabel label)
+{
+    if (label < labels.size())
+        labels[label].compact();
+}
+
+
+void CFLRGraph::reserveLabels(unsigned int labelNum)
+{
+    growLabels(labelNum);
+}
+
+
+void CFLRGraph::setShardNum(unsigned int shardNum)
+{
+    unsigned bits = 0;
+    while ((1u << bits) < shardNum)
+        ++bits;
+    shardBits = bits;
+    for (LabelIndex &index : labels)
+        index.reshape(index.storage, shardBits, index.directions);
+}
+
+
+void CFLRGraph::assignEdges(EdgeLabel label, const std::vector<unsigned int> &srcs,
+                            const std::vector<unsigned int> &dsts)
+{
+    assert(getStoredLabel(label) == label && "assign the edges of the stored label instead");
+    growLabels(label + 1);
+    LabelIndex &index = labels[label];
+    index = LabelIndex(LabelStorage::Adjacency, shardBits, index.directions);
+    if (!shardBits)
+    {
+        index.assign(srcs, dsts);
+        return;
+    }
+    for (size_t i = 0; i < srcs.size(); ++i)
+        index.insert(srcs[i], dsts[i]);
+}
+
+
+void CFLRGraph::growLabels(unsigned int labelNum)
+{
+    while (labels.size() < labelNum)
+    {
+        storedLabels.push_back(labels.size());
+        reverseLabels.push_back(labels.size());
+        labels.emplace_back(LabelStorage::Adjacency, shardBits, BothDirections);
+    }
+}
+
+
+bool CFLRGraph::isObjectNode(unsigned int node)
+{
+    bool object = false;
+    if (Addr < labels.size())
+        labels[Addr].forEachSuccessor(node, [&](unsigned) { object = true; });
+    return object;
+}
+
+
+void CFLR::buildGraph(SVF::PAG *pag)
+{
+    if (graph)
+        return;
+    CFLR_STAT(auto timer = stats.time("build"));
+    if (substitution)
+        nodeMap = VariableSubstitution(pag).getReps();
+    graph = new CFLRGraph(pag, nodeMap);
+}
+
+
+void CFLR::buildGraph(const std::vector<CFLREdge> &stmts)
+{
+    if (graph)
+        return;
+    CFLR_STAT(auto timer = stats.time("build"));
+    if (substitution)
+    {
+        std::vector<std::pair<unsigned, unsigned>> copies, addrs, others;
+        for (const CFLREdge &stmt : stmts)
+        {
+            auto &kind = stmt.label == Copy ? copies : stmt.label == Addr ? addrs : others;
+            kind.emplace_back(stmt.src, stmt.dst);
+        }
+        nodeMap = VariableSubstitution(copies, addrs, others).getReps();
+    }
+    graph = new CFLRGraph(stmts, nodeMap);
+}
+
+
+bool CFLR::useVariableSubstitution()
+{
+    // Value numbers follow the points-to semantics of Copy, Addr, Load and Store
+    if (!ruleKernels)
+        return false;
+    substitution = true;
+    return true;
+}
+
+
+void CFLR::useClosureBitSets()
+{
+    for (EdgeLabel label : {VF, VFBar, VA, PT})
+        graph->setLabelStorage(label, LabelStorage::BitSet);
+}
+
+
+bool parseWorkOrder(const std::string &name, WorkOrder &order)
+{
+    static const std::pair<const char *, WorkOrder> orders[] = {
+            {"fifo", WorkOrder::Fifo},
+            {"lifo", WorkOrder::Lifo},
+            {"per-label", WorkOrder::PerLabel},
+            {"label-priority", WorkOrder::LabelPriority},
+            {"topological", WorkOrder::Topological},
+    };
+    for (const auto &known : orders)
     {
-        unsigned src = nodeItr.first;
-        for (auto &lblItr : nodeItr.second)
+        if (name == known.first)
         {
-            if (lblItr.first == PT)
-                for (auto dst : lblItr.second)
-                    edgeSet[src].insert(dst);
+            order = known.second;
+            return true;
         }
     }
+    return false;
+}
 
-    // Write S-edges
-    for (auto &srcItr : edgeSet)
+
+bool CFLR::useBarSymmetry()
+{
+    // The points-to grammar derives each of these Bar labels exactly as the reverse of its base
+    if (!ruleKernels)
+        return false;
+    for (EdgeLabel label : {Addr, Copy, Store, Load, PT, SV, VF})
     {
-        for (auto dst : srcItr.second)
+        if (graph->getReverseLabel(label) == label)
+            graph->mirrorLabel(label + 1, label);
+    }
+    return true;
+}
+
+
+void CFLR::dumpResult()
+{
+    std::vector<unsigned> nodes(std::max<size_t>(graph->getNodeNum(), nodeMap.size()));
+    for (unsigned src = 0; src < nodes.size(); ++src)
+        nodes[src] = src;
+    dumpResult(nodes);
+}
+
+
+void CFLR::dumpResult(const std::vector<unsigned> &nodes)
+{
+    CFLR_STAT(auto timer = stats.time("dump"));
+    std::string module = resultName.empty() ? SVF::PAG::getPAG()->getModuleIdentifier() : resultName;
+
+    std::vector<unsigned> srcs(nodes);
+    std::sort(srcs.begin(), srcs.end());
+    srcs.erase(std::unique(srcs.begin(), srcs.end()), srcs.end());
+
+    // Write S-edges; compact rows hold their successors in ascending order
+    graph->compact();
+    if (textOutput)
+        dumpText(module + ".res.txt", srcs);
+    if (binaryOutput)
+        dumpBinary(module + ".res.bin", srcs);
+}
+
+
+bool CFLR::writeStats(const std::string &fname, [[maybe_unused]] const std::string &format) const
+{
+#ifdef CFLR_STATS
+    return stats.write(fname, format, grammar, graph);
+#else
+    std::cout << "solver statistics are compiled out, build with -DCFLR_STATS=ON to write " + fname + "\n";
+    return false;
+#endif
+}
+
+
+void CFLR::setStatsInterval([[maybe_unused]] unsigned ms)
+{
+    CFLR_STAT(stats.setSampleInterval(ms));
+}
+
+
+void CFLR::dumpText(const std::string &fname, const std::vector<unsigned> &srcs)
+{
+    // A run stopped at a budget has a subset of the fixed point, noted on the first line
+    std::string mark = isComplete() ? "" : "incomplete: solving stopped at the " + stopReason +
+                                           ", points-to sets may miss targets";
+    std::vector<unsigned> dsts;
+    size_t mappedSize = 0;
+    if (mappedOutput)
+    {
+        if (!mark.empty())
+            mappedSize += ResultWriter::getCommentSize(mark);
+        for (unsigned src : srcs)
         {
-            outFile << srcItr.first << '\t' << "points to" << '\t' << dst << std::endl;
+            dsts.clear();
+            graph->collectSuccessors(getGraphNode(src), PT, dsts);
+            mappedSize += ResultWriter::getTextSize(src, dsts);
         }
     }
+
+    ResultWriter writer(fname, mappedSize);
+    if (!writer.isOpen())
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return;
+    }
+    if (!mark.empty())
+        writer.writeComment(mark);
+    for (unsigned src : srcs)
+    {
+        dsts.clear();
+        graph->collectSuccessors(getGraphNode(src), PT, dsts);
+        writer.writePointsTo(src, dsts);
+    }
+    if (!writer.close())
+        std::cout << "error writing " + fname + "!!\n";
+}
+
+
+void CFLR::dumpBinary(const std::string &fname, const std::vector<unsigned> &srcs)
+{
+    PointsToFileWriter writer(fname, srcs.empty() ? 0 : srcs.back() + 1,
+                              isComplete() ? 0 : PointsToFile::Incomplete);
+    if (!writer.isOpen())
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return;
+    }
+    std::vector<unsigned> dsts;
+    for (unsigned src : srcs)
+    {
+        dsts.clear();
+        graph->collectSuccessors(getGraphNode(src), PT, dsts);
+        writer.writePointsTo(src, dsts);
+    }
+    if (!writer.close())
+        std::cout << "error writing " + fname + "!!\n";
 }
\ No newline at end of file
@@ -0,0 +1,169 @@
+/**
+ * AdjacencyIndex.cpp
+ */
+
+#include "AdjacencyIndex.h"
+
+#include <algorithm>
+
+namespace
+{
+constexpr unsigned MinRowCapacity = 4;
+constexpr size_t MinCompactSize = 1 << 16;
+
+/// Deltas are allowed to grow to about the square root of the sorted part
+inline unsigned deltaLimit(unsigned sorted)
+{
+    unsigned limit = 8;
+    while ((size_t) limit * limit < sorted)
+        limit <<= 1;
+    return limit;
+}
+}
+
+
+bool AdjacencyIndex::contains(unsigned node, unsigned target) const
+{
+    if (node >= rows.size())
+        return false;
+    const Row &row = rows[node];
+    auto begin = arena.begin() + row.offset;
+    auto mid = begin + row.sorted;
+    if (std::binary_search(begin, mid, target))
+        return true;
+    return std::find(mid, begin + row.size, target) != begin + row.size;
+}
+
+
+bool AdjacencyIndex::insert(unsigned node, unsigned target)
+{
+    if (contains(node, target))
+        return false;
+    append(node, target);
+    return true;
+}
+
+
+void AdjacencyIndex::append(unsigned node, unsigned target)
+{
+    if (node >= rows.size())
+        rows.resize(node + 1);
+
+    Row &row = rows[node];
+    if (row.size == row.capacity)
+        relocate(row, std::max(MinRowCapacity, row.capacity * 2));
+    arena[row.offset + row.size++] = target;
+    ++liveNum;
+
+    if (row.size - row.sorted > deltaLimit(row.sorted))
+        mergeDelta(row);
+    if (deadNum > liveNum && deadNum > MinCompactSize)
+        compact();
+}
+
+
+bool AdjacencyIndex::erase(unsigned node, unsigned target)
+{
+    if (node >= rows.size())
+        return false;
+    Row &row = rows[node];
+    auto begin = arena.begin() + row.offset;
+    auto mid = begin + row.sorted;
+    auto end = begin + row.size;
+    auto pos = std::lower_bound(begin, mid, target);
+    if (pos == mid || *pos != target)
+    {
+        pos = std::find(mid, end, target);
+        if (pos == end)
+            return false;
+    }
+    else
+        --row.sorted;
+    std::copy(pos + 1, end, pos);
+    --row.size;
+    --liveNum;
+    return true;
+}
+
+
+void AdjacencyIndex::assign(const std::vector<unsigned> &nodes, const std::vector<unsigned> &targets)
+{
+    unsigned nodeNum = 0;
+    for (unsigned node : nodes)
+        nodeNum = std::max(nodeNum, node + 1);
+
+    rows.assign(nodeNum, Row());
+    for (unsigned node : nodes)
+        ++rows[node].capacity;
+    size_t offset = 0;
+    for (Row &row : rows)
+    {
+        row.offset = offset;
+        offset += row.capacity;
+    }
+
+    arena.assign(offset, 0);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        Row &row = rows[nodes[i]];
+        arena[row.offset + row.size++] = targets[i];
+    }
+    for (Row &row : rows)
+    {
+        auto begin = arena.begin() + row.offset;
+        if (!std::is_sorted(begin, begin + row.size))
+            std::sort(begin, begin + row.size);
+        row.sorted = row.size;
+    }
+    liveNum = offset;
+    deadNum = 0;
+}
+
+
+void AdjacencyIndex::collect(unsigned node, std::vector<unsigned> &out) const
+{
+    if (node >= rows.size())
+        return;
+    const Row &row = rows[node];
+    out.insert(out.end(), arena.begin() + row.offset, arena.begin() + row.offset + row.size);
+}
+
+
+void AdjacencyIndex::compact()
+{
+    std::vector<unsigned> packed;
+    packed.reserve(liveNum);
+    for (Row &row : rows)
+    {
+        mergeDelta(row);
+        size_t offset = packed.size();
+        packed.insert(packed.end(), arena.begin() + row.offset, arena.begin() + row.offset + row.size);
+        row.offset = offset;
+        row.capacity = row.size;
+    }
+    arena.swap(packed);
+    deadNum = 0;
+}
+
+
+void AdjacencyIndex::relocate(Row &row, unsigned capacity)
+{
+    size_t offset = arena.size();
+    arena.resize(offset + capacity);
+    std::copy(arena.begin() + row.offset, arena.begin() + row.offset + row.size, arena.begin() + offset);
+    deadNum += row.capacity;
+    row.offset = offset;
+    row.capacity = capacity;
+    mergeDelta(row);
+}
+
+
+void AdjacencyIndex::mergeDelta(Row &row)
+{
+    if (row.sorted == row.size)
+        return;
+    auto begin = arena.begin() + row.offset;
+    std::sort(begin + row.sorted, begin + row.size);
+    std::inplace_merge(begin, begin + row.sorted, begin + row.size);
+    row.sorted = row.size;
+}
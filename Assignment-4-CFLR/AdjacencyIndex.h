@@ -0,0 +1,95 @@
+/**
+ * AdjacencyIndex.h
+ */
+
+#ifndef ANSWERS_ADJACENCYINDEX_H
+#define ANSWERS_ADJACENCYINDEX_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * The adjacency of one edge label in one direction, indexed densely by node ID.
+ *
+ * Every node owns a row in a shared arena, laid out like a CSR segment. The front of a
+ * row is kept sorted; new targets are appended to an unsorted delta at its tail and merged
+ * into the sorted part once the delta outgrows a limit. A full row is moved to the end of
+ * the arena with twice its capacity, and the whole arena is compacted back into plain CSR
+ * once the space left behind by moved rows exceeds the live edges.
+ */
+class AdjacencyIndex
+{
+public:
+    /// Check whether node -> target is in the index
+    bool contains(unsigned node, unsigned target) const;
+
+    /**
+     * Add node -> target to the index
+     * @return true if the target was not in the row before
+     */
+    bool insert(unsigned node, unsigned target);
+
+    /// Add node -> target without checking whether it is already there
+    void append(unsigned node, unsigned target);
+
+    /**
+     * Remove node -> target from the index; the rest of the row keeps its order
+     * @return true if the target was in the row
+     */
+    bool erase(unsigned node, unsigned target);
+
+    /**
+     * Replace the content with the edges nodes[i] -> targets[i], laid out as plain CSR in a
+     * single allocation: the targets are counted per node first, then filled in.
+     * The edges must be distinct.
+     */
+    void assign(const std::vector<unsigned> &nodes, const std::vector<unsigned> &targets);
+
+    /// Number of targets of a node
+    inline unsigned degree(unsigned node) const
+    { return node < rows.size() ? rows[node].size : 0; }
+
+    /// Number of edges in the index
+    inline size_t size() const
+    { return liveNum; }
+
+    /// One past the largest node ID owning a row
+    inline unsigned getNodeNum() const
+    { return rows.size(); }
+
+    /// Visit the targets of a node; they come out sorted if the index is compact
+    template<class F>
+    inline void forEach(unsigned node, F f) const
+    {
+        if (node >= rows.size())
+            return;
+        const Row &row = rows[node];
+        for (size_t i = row.offset, e = row.offset + row.size; i < e; ++i)
+            f(arena[i]);
+    }
+
+    /// Append the targets of a node to out
+    void collect(unsigned node, std::vector<unsigned> &out) const;
+
+    /// Sort every row and pack the arena so that no dead space or delta is left
+    void compact();
+
+private:
+    struct Row
+    {
+        size_t offset = 0;      // start of the row in the arena
+        unsigned sorted = 0;    // length of the sorted prefix
+        unsigned size = 0;      // number of targets
+        unsigned capacity = 0;  // slots reserved in the arena
+    };
+
+    void relocate(Row &row, unsigned capacity);
+    void mergeDelta(Row &row);
+
+    std::vector<Row> rows;
+    std::vector<unsigned> arena;
+    size_t liveNum = 0;     // targets stored in rows
+    size_t deadNum = 0;     // arena slots left behind by relocated rows
+};
+
+#endif //ANSWERS_ADJACENCYINDEX_H
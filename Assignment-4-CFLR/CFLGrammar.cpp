@@ -0,0 +1,288 @@
+/**
+ * CFLGrammar.cpp
+ */
+
+#include "A4Header.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+
+const std::vector<EdgeLabel> CFLGrammar::noLabels;
+const std::vector<CFLGrammar::Partner> CFLGrammar::noPartners;
+const std::vector<CFLGrammar::BinaryRule> CFLGrammar::noRules;
+
+namespace
+{
+/// Names of EdgeLabelType, in declaration order
+const char *const edgeLabelNames[] = {
+        "Addr", "AddrBar",
+        "Copy", "CopyBar",
+        "Store", "StoreBar",
+        "Load", "LoadBar",
+        "PT", "PTBar",
+        "SV", "SVBar",
+        "PV", "PVBar",
+        "VP", "VPBar",
+        "VF", "VFBar",
+        "VA", "VABar",
+        "LV", "LVBar",
+};
+
+template<class T>
+inline std::vector<T> &slot(std::vector<std::vector<T>> &table, EdgeLabel label)
+{
+    if (label >= table.size())
+        table.resize(label + 1);
+    return table[label];
+}
+}
+
+
+CFLGrammar::CFLGrammar()
+{
+    for (const char *name : edgeLabelNames)
+        getLabel(name);
+    assert(getLabelNum() == LVBar + 1 && "edgeLabelNames is out of sync with EdgeLabelType");
+}
+
+
+CFLGrammar CFLGrammar::pointsTo()
+{
+    CFLGrammar g;
+    g.addBinaryRule(PT, VFBar, AddrBar);
+    g.addBinaryRule(PTBar, Addr, VF);
+    g.addBinaryRule(VF, VF, VF);
+    g.addUnaryRule(VF, Copy);
+    g.addBinaryRule(VF, SV, Load);
+    g.addBinaryRule(VF, PV, Load);
+    g.addBinaryRule(VF, Store, VP);
+    g.addBinaryRule(VFBar, VFBar, VFBar);
+    g.addUnaryRule(VFBar, CopyBar);
+    g.addBinaryRule(VFBar, LoadBar, SVBar);
+    g.addBinaryRule(VFBar, LoadBar, VP);
+    g.addBinaryRule(VFBar, PV, StoreBar);
+    g.addBinaryRule(VA, LV, Load);
+    g.addBinaryRule(VA, VFBar, VA);
+    g.addBinaryRule(VA, VA, VF);
+    g.addBinaryRule(SV, Store, VA);
+    g.addBinaryRule(SVBar, VA, StoreBar);
+    g.addBinaryRule(PV, PTBar, VA);
+    g.addBinaryRule(VP, VA, PT);
+    g.addBinaryRule(LV, LoadBar, VA);
+    g.addEpsilonRule(VF);
+    g.addEpsilonRule(VFBar);
+    g.addEpsilonRule(VA);
+    return g;
+}
+
+
+bool CFLGrammar::loadFromFile(const std::string &fname)
+{
+    std::ifstream inFile(fname);
+    if (!inFile)
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return false;
+    }
+
+    std::string line;
+    for (unsigned lineNo = 1; std::getline(inFile, line); ++lineNo)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        std::string head, arrow;
+        if (!(tokens >> head))
+            continue;
+        if (!(tokens >> arrow) || arrow != "::=")
+        {
+            std::cout << fname << ":" << lineNo << ": expected '<label> ::= ...'\n";
+            return false;
+        }
+
+        // alternatives are separated by '|'
+        std::vector<std::vector<std::string>> alternatives(1);
+        for (std::string token; tokens >> token;)
+        {
+            if (token == "|")
+                alternatives.emplace_back();
+            else if (token != "epsilon")
+                alternatives.back().push_back(token);
+        }
+
+        EdgeLabel lhs = getLabel(head);
+        for (const auto &rhs : alternatives)
+        {
+            std::vector<EdgeLabel> body;
+            for (const std::string &name : rhs)
+                body.push_back(getLabel(name));
+            addRule(lhs, body);
+        }
+    }
+    return true;
+}
+
+
+EdgeLabel CFLGrammar::getLabel(const std::string &name)
+{
+    auto it = labelIds.find(name);
+    if (it != labelIds.end())
+        return it->second;
+    EdgeLabel label = labelNames.size();
+    labelNames.push_back(name);
+    labelIds[name] = label;
+    return label;
+}
+
+
+void CFLGrammar::normalize()
+{
+    // Split long rules from the left, naming each remaining suffix after its labels
+    for (const auto &rule : longRules)
+    {
+        const std::vector<EdgeLabel> &body = rule.second;
+        EdgeLabel head = rule.first;
+        size_t i = 0;
+        for (; i + 2 < body.size(); ++i)
+        {
+            std::string suffix = "<";
+            for (size_t j = i + 1; j < body.size(); ++j)
+                suffix += (j > i + 1 ? " " : "") + getLabelName(body[j]);
+            suffix += ">";
+            bool split = labelIds.count(suffix);
+            EdgeLabel rest = getLabel(suffix);
+            addBinaryRule(head, body[i], rest);
+            if (split)
+                break;
+            head = rest;
+        }
+        if (i + 2 == body.size())
+            addBinaryRule(head, body[i], body[i + 1]);
+    }
+    longRules.clear();
+
+    // Nullable labels: A ::= epsilon, A ::= B with B nullable, A ::= B C with both nullable
+    std::vector<bool> nullable(getLabelNum(), false);
+    for (EdgeLabel label : epsilonLabels)
+        nullable[label] = true;
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        auto derive = [&](EdgeLabel head) {
+            if (!nullable[head])
+                changed = nullable[head] = true;
+        };
+        for (const UnaryRule &rule : unaryRules)
+        {
+            if (nullable[rule.body])
+                derive(rule.head);
+        }
+        for (const BinaryRule &rule : binaryRules)
+        {
+            if (nullable[rule.left] && nullable[rule.right])
+                derive(rule.head);
+        }
+    }
+    epsilonLabels.clear();
+    for (EdgeLabel label = 0; label < getLabelNum(); ++label)
+    {
+        if (nullable[label])
+            epsilonLabels.push_back(label);
+    }
+
+    // A nullable operand acts as the identity: A ::= B C gives A ::= C or A ::= B
+    for (size_t i = 0; i < binaryRules.size(); ++i)
+    {
+        BinaryRule rule = binaryRules[i];
+        if (nullable[rule.left])
+            addUnaryRule(rule.head, rule.right);
+        if (nullable[rule.right])
+            addUnaryRule(rule.head, rule.left);
+    }
+
+    // Close unary chains: H ::= A and A ::= B give H ::= B
+    for (bool changed = true; changed;)
+    {
+        changed = false;
+        for (size_t i = 0; i < unaryRules.size(); ++i)
+        {
+            UnaryRule rule = unaryRules[i];
+            std::vector<EdgeLabel> heads = getUnaryHeads(rule.head);
+            for (EdgeLabel head : heads)
+                changed |= addUnaryRule(head, rule.body);
+        }
+    }
+}
+
+
+bool CFLGrammar::sameRules(const CFLGrammar &other) const
+{
+    auto sameSet = [](auto lhs, auto rhs, auto key) {
+        if (lhs.size() != rhs.size())
+            return false;
+        auto less = [&](const auto &a, const auto &b) { return key(a) < key(b); };
+        std::sort(lhs.begin(), lhs.end(), less);
+        std::sort(rhs.begin(), rhs.end(), less);
+        for (size_t i = 0; i < lhs.size(); ++i)
+        {
+            if (key(lhs[i]) != key(rhs[i]))
+                return false;
+        }
+        return true;
+    };
+    return longRules.empty() && other.longRules.empty() &&
+           sameSet(epsilonLabels, other.epsilonLabels, [](EdgeLabel l) { return l; }) &&
+           sameSet(unaryRules, other.unaryRules,
+                   [](const UnaryRule &r) { return std::make_pair(r.head, r.body); }) &&
+           sameSet(binaryRules, other.binaryRules,
+                   [](const BinaryRule &r) { return std::make_tuple(r.head, r.left, r.right); });
+}
+
+
+void CFLGrammar::addRule(EdgeLabel head, const std::vector<EdgeLabel> &body)
+{
+    if (body.empty())
+        addEpsilonRule(head);
+    else if (body.size() == 1)
+        addUnaryRule(head, body[0]);
+    else if (body.size() == 2)
+        addBinaryRule(head, body[0], body[1]);
+    else
+        longRules.emplace_back(head, body);
+}
+
+
+void CFLGrammar::addEpsilonRule(EdgeLabel head)
+{
+    if (std::find(epsilonLabels.begin(), epsilonLabels.end(), head) == epsilonLabels.end())
+        epsilonLabels.push_back(head);
+}
+
+
+bool CFLGrammar::addUnaryRule(EdgeLabel head, EdgeLabel body)
+{
+    if (head == body)
+        return false;
+    std::vector<EdgeLabel> &heads = slot(unaryHeads, body);
+    if (std::find(heads.begin(), heads.end(), head) != heads.end())
+        return false;
+    heads.push_back(head);
+    slot(unaryBodies, head).push_back(body);
+    unaryRules.push_back({head, body});
+    return true;
+}
+
+
+void CFLGrammar::addBinaryRule(EdgeLabel head, EdgeLabel left, EdgeLabel right)
+{
+    for (const BinaryRule &rule : binaryRules)
+    {
+        if (rule.head == head && rule.left == left && rule.right == right)
+            return;
+    }
+    binaryRules.push_back({head, left, right});
+    slot(leftRules, left).push_back({head, right});
+    slot(rightRules, right).push_back({head, left});
+    slot(headRules, head).push_back({head, left, right});
+}
@@ -4,319 +4,341 @@
  */
 
 #include "A4Header.h"
+#include "EdgeList.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iterator>
+#include <sstream>
 
 using namespace SVF;
 using namespace llvm;
 using namespace std;
 
-int main(int argc, char **argv)
-{
-    auto moduleNameVec =
-            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
-                                     "[options] <input-bitcode...>");
+static const Option<bool> ClosureBitSets(
+        "cflr-bitset",
+        "Store the closure labels (VF, VFBar, VA, PT) as sparse bitsets",
+        false);
 
-    LLVMModuleSet::buildSVFModule(moduleNameVec);
+static const Option<bool> BarSymmetry(
+        "cflr-bar-symmetry",
+        "Store each label and its Bar label once, serving the Bar label from the reverse index (built-in grammar)",
+        false);
 
-    SVFIRBuilder builder;
-    auto pag = builder.build();
-    pag->dump("PAG");
+static const Option<std::string> GrammarFile(
+        "cflr-grammar",
+        "Read the CFL grammar from a file instead of using the built-in points-to grammar",
+        "");
 
-    CFLR solver;
-    solver.buildGraph(pag);
-    solver.solve();
-    solver.dumpResult();
+static const Option<bool> LabelQueues(
+        "cflr-label-queues",
+        "Keep one worklist queue per label and drain them label by label",
+        false);
 
-    LLVMModuleSet::releaseLLVMModuleSet();
-    return 0;
-}
+static const Option<std::string> WorkOrderName(
+        "cflr-order",
+        "Order of the worklist: fifo, lifo, per-label, label-priority or topological (Copy SCC DAG)",
+        "fifo");
+
+static const Option<std::string> SolverMode(
+        "cflr-mode",
+        "How to evaluate the grammar: worklist (one edge at a time) or semi-naive (in rounds)",
+        "worklist");
+
+static const Option<u32_t> ThreadNum(
+        "cflr-threads",
+        "Number of solver threads; more than one implies the round-based (semi-naive) evaluation",
+        1);
+
+static const Option<bool> CollapseCycles(
+        "cflr-collapse-cycles",
+        "Merge the pointers on VF cycles into one node while solving (worklist mode, built-in grammar)",
+        false);
+
+static const Option<bool> Substitution(
+        "cflr-hvn",
+        "Merge pointer-equivalent PAG nodes by value numbering before building the graph (built-in grammar)",
+        false);
+
+static const Option<bool> MappedOutput(
+        "cflr-mmap-output",
+        "Write the result file through a memory mapping of its exact size",
+        false);
+
+static const Option<std::string> OutputFormat(
+        "cflr-format",
+        "Result file format: text (<module>.res.txt), binary (<module>.res.bin, indexed) or both",
+        "text");
+
+static const Option<std::string> SnapshotFile(
+        "cflr-snapshot",
+        "Snapshot file of the solved graph: loaded if saved for the same input, saved after solving",
+        "");
+
+static const Option<u32_t> CheckpointInterval(
+        "cflr-checkpoint",
+        "Seconds between snapshots of the progress while solving, resumable after a crash (0: off)",
+        0);
+
+static const Option<u32_t> TimeBudget(
+        "cflr-time-budget",
+        "Seconds solving may run before it stops with incomplete results, exit code 2 (0: no limit)",
+        0);
+
+static const Option<u32_t> MemoryBudget(
+        "cflr-memory-budget",
+        "MiB of resident memory solving may use before it stops with incomplete results, exit code 2 (0: no limit)",
+        0);
+
+static const Option<u32_t> ProgressInterval(
+        "cflr-progress",
+        "Seconds between progress lines while solving (0: none)",
+        0);
 
+static const Option<std::string> EdgeFile(
+        "cflr-edges",
+        "Edge-list file of statements to solve instead of bitcode, see EdgeList.h",
+        "");
 
-void CFLR::solve()
+static const Option<std::string> AddedEdges(
+        "cflr-add-edges",
+        "Edge-list file of statements to add once the program is solved, carried on incrementally",
+        "");
+
+static const Option<std::string> RemovedEdges(
+        "cflr-remove-edges",
+        "Edge-list file of statements to remove once the program is solved, after -cflr-add-edges",
+        "");
+
+static const Option<bool> CheckDelta(
+        "cflr-check-delta",
+        "Check the graph updated by -cflr-add-edges/-cflr-remove-edges against solving the changed program anew",
+        false);
+
+static const Option<std::string> StatsFile(
+        "cflr-stats",
+        "File to write the solver statistics to at the end of the run (builds with CFLR_STATS only)",
+        "");
+
+static const Option<std::string> StatsFormat(
+        "cflr-stats-format",
+        "Format of the solver statistics: json or csv",
+        "json");
+
+static const Option<u32_t> StatsInterval(
+        "cflr-stats-interval",
+        "Milliseconds between samples of the solving progress in the statistics (0: none)",
+        0);
+
+static const Option<std::string> QueryNodes(
+        "cflr-query",
+        "Comma-separated node IDs; only their points-to sets are derived and dumped",
+        "");
+
+/// Parse a comma-separated list of node IDs
+static bool parseNodeList(const std::string &list, std::vector<unsigned> &nodes)
 {
-    // 收集所有节点并初始化工作表
-    std::unordered_set<unsigned> allNodes;
-    
-    // 将图中所有已存在的边加入工作表
-    for (auto &nodeItr : graph->getSuccessorMap())
+    std::istringstream tokens(list);
+    for (std::string token; std::getline(tokens, token, ',');)
     {
-        unsigned src = nodeItr.first;
-        allNodes.insert(src);
-        
-        for (auto &lblItr : nodeItr.second)
+        if (token.empty())
+            continue;
+        char *end = nullptr;
+        unsigned long node = std::strtoul(token.c_str(), &end, 10);
+        if (!std::isdigit((unsigned char) token[0]) || *end != '\0')
         {
-            EdgeLabel label = lblItr.first;
-            for (auto dst : lblItr.second)
-            {
-                allNodes.insert(dst);
-                workList.push(CFLREdge(src, dst, label));
-            }
+            std::cout << "bad node ID '" << token << "' in -cflr-query\n";
+            return false;
         }
+        nodes.push_back(node);
     }
-    
-    // 辅助 lambda 函数：添加边（如果不存在则加入图和工作表）
-    auto addEdge = [this](unsigned src, unsigned dst, EdgeLabel label) {
-        if (!graph->hasEdge(src, dst, label))
-        {
-            graph->addEdge(src, dst, label);
-            workList.push(CFLREdge(src, dst, label));
-        }
+    return true;
+}
+
+/// Every edge of the solved graph under each label of the grammar, sorted
+static std::vector<CFLREdge> collectEdges(const CFLR &solver)
+{
+    std::vector<CFLREdge> edges;
+    for (EdgeLabel label = 0; label < solver.getGrammar().getLabelNum(); ++label)
+        solver.getGraph()->forEachEdge(label, [&](unsigned src, unsigned dst) { edges.emplace_back(src, dst, label); });
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+/**
+ * Solve the program of pag (or stmts) with the deltas applied before solving, and compare
+ * the graph with that of solver, which applied them to its solved graph
+ * @return false, printing the first differences, if the two graphs differ
+ */
+static bool checkDelta(const CFLR &solver, SVFIR *pag, const std::vector<CFLREdge> &stmts,
+                       const std::vector<CFLREdge> &added, const std::vector<CFLREdge> &removed)
+{
+    CFLR reference;
+    if (!GrammarFile().empty())
+        reference.setGrammar(solver.getGrammar());
+    if (pag)
+        reference.buildGraph(pag);
+    else
+        reference.buildGraph(stmts);
+    reference.addPAGEdges(added);
+    reference.removePAGEdges(removed);
+    reference.solve();
+
+    std::vector<CFLREdge> updated = collectEdges(solver), solved = collectEdges(reference);
+    std::vector<CFLREdge> extra, missing;
+    std::set_difference(updated.begin(), updated.end(), solved.begin(), solved.end(), std::back_inserter(extra));
+    std::set_difference(solved.begin(), solved.end(), updated.begin(), updated.end(), std::back_inserter(missing));
+    if (extra.empty() && missing.empty())
+    {
+        std::cout << "delta check passed: " << updated.size() << " edges\n";
+        return true;
+    }
+    std::cout << "delta check failed: " << extra.size() << " edges in excess, " << missing.size() << " missing\n";
+    const CFLGrammar &grammar = solver.getGrammar();
+    auto print = [&](const std::vector<CFLREdge> &edges, const char *what) {
+        for (size_t i = 0; i < edges.size() && i < 10; ++i)
+            std::cout << "  " << edges[i].src << " -" << grammar.getLabelName(edges[i].label) << "-> "
+                      << edges[i].dst << " " << what << "\n";
     };
-    
-    // 为每个节点添加 epsilon 边（VF, VFBar, VA）
-    for (auto node : allNodes)
+    print(extra, "in excess");
+    print(missing, "missing");
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    auto moduleNameVec =
+            OptionBase::parseOptions(argc, argv, "Whole Program Points-to Analysis",
+                                     "[options] <input-bitcode...> | -cflr-edges=<edge-list>");
+
+    // An edge list is solved on its own, without building a PAG
+    SVFIR *pag = nullptr;
+    std::vector<CFLREdge> stmts;
+    if (!EdgeFile().empty())
     {
-        addEdge(node, node, VF);
-        addEdge(node, node, VFBar);
-        addEdge(node, node, VA);
+        if (!EdgeList::read(EdgeFile(), stmts))
+            return 1;
     }
-    
-    // 主循环：动态规划 CFL 可达性算法
-    while (!workList.empty())
+    else
     {
-        CFLREdge edge = workList.pop();
-        unsigned x = edge.src;
-        unsigned z = edge.dst;
-        EdgeLabel label = edge.label;
-        
-        auto &succMap = graph->getSuccessorMap();
-        auto &predMap = graph->getPredecessorMap();
-        
-        // 应用语法规则 A ::= B C
-        // 情况1: 新边是 B (x -B-> z)，找所有 z -C-> w，添加 x -A-> w
-        // 情况2: 新边是 C (x -C-> z)，找所有 y -B-> x，添加 y -A-> z
-        
-        // PT ::= VFBar AddrBar
-        if (label == VFBar && succMap.count(z) && succMap[z].count(AddrBar))
-        {
-            for (auto w : succMap[z][AddrBar])
-                addEdge(x, w, PT);
-        }
-        if (label == AddrBar && predMap.count(x) && predMap[x].count(VFBar))
-        {
-            for (auto y : predMap[x][VFBar])
-                addEdge(y, z, PT);
-        }
-        
-        // PTBar ::= Addr VF
-        if (label == Addr && succMap.count(z) && succMap[z].count(VF))
-        {
-            for (auto w : succMap[z][VF])
-                addEdge(x, w, PTBar);
-        }
-        if (label == VF && predMap.count(x) && predMap[x].count(Addr))
-        {
-            for (auto y : predMap[x][Addr])
-                addEdge(y, z, PTBar);
-        }
-        
-        // VF ::= VF VF
-        if (label == VF)
-        {
-            if (succMap.count(z) && succMap[z].count(VF))
-            {
-                for (auto w : succMap[z][VF])
-                    addEdge(x, w, VF);
-            }
-            if (predMap.count(x) && predMap[x].count(VF))
-            {
-                for (auto y : predMap[x][VF])
-                    addEdge(y, z, VF);
-            }
-        }
-        
-        // VF ::= Copy
-        if (label == Copy)
-        {
-            addEdge(x, z, VF);
-        }
-        
-        // VF ::= SV Load
-        if (label == SV && succMap.count(z) && succMap[z].count(Load))
-        {
-            for (auto w : succMap[z][Load])
-                addEdge(x, w, VF);
-        }
-        if (label == Load && predMap.count(x) && predMap[x].count(SV))
-        {
-            for (auto y : predMap[x][SV])
-                addEdge(y, z, VF);
-        }
-        
-        // VF ::= PV Load
-        if (label == PV && succMap.count(z) && succMap[z].count(Load))
-        {
-            for (auto w : succMap[z][Load])
-                addEdge(x, w, VF);
-        }
-        if (label == Load && predMap.count(x) && predMap[x].count(PV))
-        {
-            for (auto y : predMap[x][PV])
-                addEdge(y, z, VF);
-        }
-        
-        // VF ::= Store VP
-        if (label == Store && succMap.count(z) && succMap[z].count(VP))
-        {
-            for (auto w : succMap[z][VP])
-                addEdge(x, w, VF);
-        }
-        if (label == VP && predMap.count(x) && predMap[x].count(Store))
-        {
-            for (auto y : predMap[x][Store])
-                addEdge(y, z, VF);
-        }
-        
-        // VFBar ::= VFBar VFBar
-        if (label == VFBar)
-        {
-            if (succMap.count(z) && succMap[z].count(VFBar))
-            {
-                for (auto w : succMap[z][VFBar])
-                    addEdge(x, w, VFBar);
-            }
-            if (predMap.count(x) && predMap[x].count(VFBar))
-            {
-                for (auto y : predMap[x][VFBar])
-                    addEdge(y, z, VFBar);
-            }
-        }
-        
-        // VFBar ::= CopyBar
-        if (label == CopyBar)
-        {
-            addEdge(x, z, VFBar);
-        }
-        
-        // VFBar ::= LoadBar SVBar
-        if (label == LoadBar && succMap.count(z) && succMap[z].count(SVBar))
-        {
-            for (auto w : succMap[z][SVBar])
-                addEdge(x, w, VFBar);
-        }
-        if (label == SVBar && predMap.count(x) && predMap[x].count(LoadBar))
-        {
-            for (auto y : predMap[x][LoadBar])
-                addEdge(y, z, VFBar);
-        }
-        
-        // VFBar ::= LoadBar VP
-        if (label == LoadBar && succMap.count(z) && succMap[z].count(VP))
-        {
-            for (auto w : succMap[z][VP])
-                addEdge(x, w, VFBar);
-        }
-        if (label == VP && predMap.count(x) && predMap[x].count(LoadBar))
-        {
-            for (auto y : predMap[x][LoadBar])
-                addEdge(y, z, VFBar);
-        }
-        
-        // VFBar ::= PV StoreBar
-        if (label == PV && succMap.count(z) && succMap[z].count(StoreBar))
-        {
-            for (auto w : succMap[z][StoreBar])
-                addEdge(x, w, VFBar);
-        }
-        if (label == StoreBar && predMap.count(x) && predMap[x].count(PV))
-        {
-            for (auto y : predMap[x][PV])
-                addEdge(y, z, VFBar);
-        }
-        
-        // VA ::= LV Load
-        if (label == LV && succMap.count(z) && succMap[z].count(Load))
-        {
-            for (auto w : succMap[z][Load])
-                addEdge(x, w, VA);
-        }
-        if (label == Load && predMap.count(x) && predMap[x].count(LV))
-        {
-            for (auto y : predMap[x][LV])
-                addEdge(y, z, VA);
-        }
-        
-        // VA ::= VFBar VA
-        if (label == VFBar && succMap.count(z) && succMap[z].count(VA))
-        {
-            for (auto w : succMap[z][VA])
-                addEdge(x, w, VA);
-        }
-        if (label == VA && predMap.count(x) && predMap[x].count(VFBar))
-        {
-            for (auto y : predMap[x][VFBar])
-                addEdge(y, z, VA);
-        }
-        
-        // VA ::= VA VF
-        if (label == VA && succMap.count(z) && succMap[z].count(VF))
-        {
-            for (auto w : succMap[z][VF])
-                addEdge(x, w, VA);
-        }
-        if (label == VF && predMap.count(x) && predMap[x].count(VA))
-        {
-            for (auto y : predMap[x][VA])
-                addEdge(y, z, VA);
-        }
-        
-        // SV ::= Store VA
-        if (label == Store && succMap.count(z) && succMap[z].count(VA))
-        {
-            for (auto w : succMap[z][VA])
-                addEdge(x, w, SV);
-        }
-        if (label == VA && predMap.count(x) && predMap[x].count(Store))
-        {
-            for (auto y : predMap[x][Store])
-                addEdge(y, z, SV);
-        }
-        
-        // SVBar ::= VA StoreBar
-        if (label == VA && succMap.count(z) && succMap[z].count(StoreBar))
-        {
-            for (auto w : succMap[z][StoreBar])
-                addEdge(x, w, SVBar);
-        }
-        if (label == StoreBar && predMap.count(x) && predMap[x].count(VA))
-        {
-            for (auto y : predMap[x][VA])
-                addEdge(y, z, SVBar);
-        }
-        
-        // PV ::= PTBar VA
-        if (label == PTBar && succMap.count(z) && succMap[z].count(VA))
-        {
-            for (auto w : succMap[z][VA])
-                addEdge(x, w, PV);
-        }
-        if (label == VA && predMap.count(x) && predMap[x].count(PTBar))
-        {
-            for (auto y : predMap[x][PTBar])
-                addEdge(y, z, PV);
-        }
-        
-        // VP ::= VA PT
-        if (label == VA && succMap.count(z) && succMap[z].count(PT))
-        {
-            for (auto w : succMap[z][PT])
-                addEdge(x, w, VP);
-        }
-        if (label == PT && predMap.count(x) && predMap[x].count(VA))
-        {
-            for (auto y : predMap[x][VA])
-                addEdge(y, z, VP);
-        }
-        
-        // LV ::= LoadBar VA
-        if (label == LoadBar && succMap.count(z) && succMap[z].count(VA))
-        {
-            for (auto w : succMap[z][VA])
-                addEdge(x, w, LV);
-        }
-        if (label == VA && predMap.count(x) && predMap[x].count(LoadBar))
-        {
-            for (auto y : predMap[x][LoadBar])
-                addEdge(y, z, LV);
-        }
+        LLVMModuleSet::buildSVFModule(moduleNameVec);
+        SVFIRBuilder builder;
+        pag = builder.build();
+        pag->dump("PAG");
     }
+
+    std::vector<unsigned> queryNodes;
+    if (!parseNodeList(QueryNodes(), queryNodes))
+        return 1;
+    if (StatsFormat() != "json" && StatsFormat() != "csv")
+    {
+        std::cout << "unknown -cflr-stats-format '" << StatsFormat() << "', expected json or csv\n";
+        return 1;
+    }
+    // Deltas change the program once it is solved, which a query never finishes
+    std::vector<CFLREdge> added, removed;
+    if (!AddedEdges().empty() && !EdgeList::read(AddedEdges(), added))
+        return 1;
+    if (!RemovedEdges().empty() && !EdgeList::read(RemovedEdges(), removed))
+        return 1;
+    bool delta = !AddedEdges().empty() || !RemovedEdges().empty();
+    if (delta && (!queryNodes.empty() || Substitution() || CollapseCycles()))
+    {
+        std::cout << "-cflr-add-edges and -cflr-remove-edges cannot be combined with -cflr-query, -cflr-hvn "
+                     "or -cflr-collapse-cycles\n";
+        return 1;
+    }
+    if (CheckDelta() && !delta)
+        std::cout << "-cflr-check-delta only applies with -cflr-add-edges or -cflr-remove-edges, ignored\n";
+    if (SolverMode() != "worklist" && SolverMode() != "semi-naive")
+    {
+        std::cout << "unknown -cflr-mode '" << SolverMode() << "', expected worklist or semi-naive\n";
+        return 1;
+    }
+
+    CFLR solver;
+    if (!GrammarFile().empty())
+    {
+        CFLGrammar grammar;
+        if (!grammar.loadFromFile(GrammarFile()))
+            return 1;
+        solver.setGrammar(grammar);
+    }
+    WorkOrder order;
+    if (!parseWorkOrder(WorkOrderName(), order))
+    {
+        std::cout << "unknown -cflr-order '" << WorkOrderName()
+                  << "', expected fifo, lifo, per-label, label-priority or topological\n";
+        return 1;
+    }
+    solver.setWorkOrder(order);
+    if (LabelQueues())
+        solver.useLabelQueues();
+    if (MappedOutput())
+        solver.useMappedOutput();
+    if (OutputFormat() == "binary")
+        solver.setOutputFormats(false, true);
+    else if (OutputFormat() == "both")
+        solver.setOutputFormats(true, true);
+    else if (OutputFormat() != "text")
+    {
+        std::cout << "unknown -cflr-format '" << OutputFormat() << "'\n";
+        return 1;
+    }
+    solver.setStatsInterval(StatsInterval());
+    solver.setBudget(TimeBudget(), MemoryBudget());
+    solver.setProgressInterval(ProgressInterval());
+    if (Substitution() && !solver.useVariableSubstitution())
+        std::cout << "-cflr-hvn only applies to the built-in grammar, ignored\n";
+    if (pag)
+        solver.buildGraph(pag);
+    else
+    {
+        solver.setResultName(EdgeFile());
+        solver.buildGraph(stmts);
+    }
+    if (BarSymmetry() && !solver.useBarSymmetry())
+        std::cout << "-cflr-bar-symmetry only applies to the built-in grammar, ignored\n";
+    if (!SnapshotFile().empty())
+        solver.useSnapshot(SnapshotFile(), CheckpointInterval());
+    if (ClosureBitSets())
+        solver.useClosureBitSets();
+    if (CollapseCycles())
+    {
+        if (!queryNodes.empty() || SolverMode() != "worklist" || ThreadNum() > 1)
+            std::cout << "-cflr-collapse-cycles only applies to the worklist mode, ignored\n";
+        else if (!solver.useCycleCollapsing())
+            std::cout << "-cflr-collapse-cycles only applies to the built-in grammar, ignored\n";
+    }
+    if (!queryNodes.empty())
+    {
+        for (unsigned node : queryNodes)
+            solver.query(node);
+        solver.dumpResult(queryNodes);
+    }
+    else
+    {
+        if (SolverMode() == "semi-naive" || ThreadNum() > 1)
+            solver.solveSemiNaive(ThreadNum());
+        else
+            solver.solve();
+        if (delta && !solver.isComplete())
+            std::cout << "solving stopped early, -cflr-add-edges and -cflr-remove-edges not applied\n";
+        else if (delta)
+        {
+            solver.addPAGEdges(added);
+            solver.removePAGEdges(removed);
+            if (CheckDelta() && !checkDelta(solver, pag, stmts, added, removed))
+                return 1;
+        }
+        solver.dumpResult();
+    }
+
+    if (!StatsFile().empty())
+        solver.writeStats(StatsFile(), StatsFormat());
+
+    if (pag)
+        LLVMModuleSet::releaseLLVMModuleSet();
+    return solver.isComplete() ? 0 : 2;
 }
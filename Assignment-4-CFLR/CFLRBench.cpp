@@ -0,0 +1,381 @@
+/**
+ * CFLRBench.cpp
+ *
+ * Times the phases of the solver (PAG building, graph construction, solving, dumping) on
+ * bitcode, on edge-list files and on synthetic programs of growing size, see
+ * SyntheticGraphs.h. Every program is reported as one JSON object per line, with the
+ * median wall time of each phase over the repetitions, the edges it handled per second
+ * and the peak resident set size of the child process that read, built and solved it, so
+ * that each program has its own peak.
+ */
+
+#include "A4Header.h"
+#include "EdgeList.h"
+#include "SyntheticGraphs.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace SVF;
+using namespace llvm;
+using namespace std;
+
+static const Option<std::string> BenchSynthetic(
+        "bench-synthetic",
+        "Comma-separated synthetic programs to run: chain, web, list, random (empty: none)",
+        "chain,web,list");
+
+static const Option<std::string> BenchEdges(
+        "bench-edges",
+        "Comma-separated edge-list files to run, see EdgeList.h and cflr-gen",
+        "");
+
+static const Option<std::string> BenchSizes(
+        "bench-sizes",
+        "Comma-separated sizes of the synthetic programs",
+        "1000,10000,100000");
+
+static const Option<u32_t> BenchRepeat(
+        "bench-repeat",
+        "Number of runs of every program; the median time of each phase is reported",
+        3);
+
+static const Option<u32_t> BenchSeed(
+        "bench-seed",
+        "Seed of the random synthetic programs",
+        1);
+
+static const Option<std::string> BenchOutput(
+        "bench-output",
+        "File to append the JSON lines to (empty: standard output)",
+        "");
+
+static const Option<std::string> BenchMode(
+        "bench-mode",
+        "Solver: worklist or semi-naive",
+        "worklist");
+
+static const Option<u32_t> BenchThreads(
+        "bench-threads",
+        "Number of threads of the semi-naive solver",
+        1);
+
+static const Option<bool> BenchBitSets(
+        "bench-bitset",
+        "Store the closure labels as sparse bitsets",
+        false);
+
+static const Option<bool> BenchBarSymmetry(
+        "bench-bar-symmetry",
+        "Store each label and its Bar label once",
+        false);
+
+static const Option<std::string> BenchOrder(
+        "bench-order",
+        "Order of the worklist: fifo, lifo, per-label, label-priority or topological",
+        "fifo");
+
+/// The work of the solver in one run, see SolverStats.h; counted in builds with CFLR_STATS only
+struct Work
+{
+    uint64_t popped = 0;
+    uint64_t derived = 0;
+    uint64_t duplicates = 0;
+    uint64_t probes = 0;
+};
+
+/// One timed phase: median time over the runs, and the edges it handled in one run
+struct Phase
+{
+    const char *name;
+    std::vector<double> ms;
+    size_t edges = 0;
+
+    explicit Phase(const char *name) : name(name)
+    {}
+
+    double median()
+    {
+        std::sort(ms.begin(), ms.end());
+        return ms.empty() ? 0 : ms[ms.size() / 2];
+    }
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+/// A program name as a JSON string; edge-list paths may hold quotes and backslashes
+static std::string jsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            quoted += {'\\', c};
+        else if ((unsigned char) c < 0x20)
+        {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char) c);
+            quoted += escape;
+        }
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static size_t countEdges(const CFLR &solver, EdgeLabel label)
+{
+    return solver.getGraph()->getEdgeNum(label);
+}
+
+static size_t countEdges(const CFLR &solver)
+{
+    size_t num = 0;
+    for (EdgeLabel label = 0; label < solver.getGrammar().getLabelNum(); ++label)
+        num += countEdges(solver, label);
+    return num;
+}
+
+/// Build, solve and dump a program once, adding the times to the phases
+template<class Build>
+static void runOnce(const std::string &name, Build build, Phase &graph, Phase &solve, Phase &dump,
+                    [[maybe_unused]] Work &work)
+{
+    CFLR solver;
+    solver.setResultName(name);
+    WorkOrder order = WorkOrder::Fifo;
+    parseWorkOrder(BenchOrder(), order);    // checked in main
+    solver.setWorkOrder(order);
+
+    auto start = std::chrono::steady_clock::now();
+    build(solver);
+    if (BenchBarSymmetry())
+        solver.useBarSymmetry();
+    if (BenchBitSets())
+        solver.useClosureBitSets();
+    graph.ms.push_back(elapsedMs(start));
+    graph.edges = countEdges(solver);
+
+    start = std::chrono::steady_clock::now();
+    if (BenchMode() == "semi-naive" || BenchThreads() > 1)
+        solver.solveSemiNaive(BenchThreads());
+    else
+        solver.solve();
+    solve.ms.push_back(elapsedMs(start));
+    solve.edges = countEdges(solver) - graph.edges;
+#ifdef CFLR_STATS
+    work.popped = solver.getStats().getPopped();
+    work.derived = solver.getStats().getDerived();
+    work.duplicates = solver.getStats().getDuplicates();
+    work.probes = solver.getStats().getProbes();
+#endif
+
+    start = std::chrono::steady_clock::now();
+    solver.dumpResult();
+    dump.ms.push_back(elapsedMs(start));
+    dump.edges = countEdges(solver, PT);
+    std::remove((name + ".res.txt").c_str());
+}
+
+/// Write one program as a JSON line, leaving it open for runIsolated to add the peak RSS
+static void report(std::ostream &line, const std::string &program, size_t size, size_t stmtNum,
+                   std::vector<Phase> &phases, [[maybe_unused]] const Work &work)
+{
+    line << "{\"program\":" << jsonString(program) << ",\"size\":" << size << ",\"statements\":" << stmtNum
+         << ",\"mode\":\"" << BenchMode() << "\",\"threads\":" << BenchThreads()
+         << ",\"bitset\":" << (BenchBitSets() ? "true" : "false")
+         << ",\"barSymmetry\":" << (BenchBarSymmetry() ? "true" : "false")
+         << ",\"order\":\"" << BenchOrder() << "\",\"repeat\":" << BenchRepeat()
+         << ",\"phases\":{";
+    double total = 0;
+    for (size_t i = 0; i < phases.size(); ++i)
+    {
+        double ms = phases[i].median();
+        total += ms;
+        line << (i ? "," : "") << "\"" << phases[i].name << "\":{\"ms\":" << ms
+             << ",\"edges\":" << phases[i].edges
+             << ",\"edgesPerSec\":" << (ms > 0 ? (size_t) (phases[i].edges / ms * 1000) : 0) << "}";
+    }
+    line << "}";
+#ifdef CFLR_STATS
+    line << ",\"work\":{\"popped\":" << work.popped << ",\"derived\":" << work.derived
+         << ",\"duplicates\":" << work.duplicates << ",\"probes\":" << work.probes << "}";
+#endif
+    line << ",\"totalMs\":" << total;
+}
+
+/**
+ * Run one program in a child process, whose peak resident set size is then that of the
+ * program alone: measure writes the JSON line of the program to a stream, and the parent
+ * closes it with the peak RSS of the child, in KiB
+ * @return false if measure fails or the child does not exit normally
+ */
+template<class Measure>
+static bool runIsolated(std::ostream &out, Measure measure)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        std::perror("pipe");
+        return false;
+    }
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::perror("fork");
+        return false;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        std::ostringstream line;
+        bool ok = measure(line);
+        std::string text = line.str();
+        for (size_t done = 0; ok && done < text.size();)
+        {
+            ssize_t n = write(fds[1], text.data() + done, text.size() - done);
+            ok = n > 0;
+            done += ok ? n : 0;
+        }
+        std::cout.flush();
+        _exit(ok ? 0 : 1);
+    }
+
+    close(fds[1]);
+    std::string text;
+    char buffer[4096];
+    for (ssize_t n; (n = read(fds[0], buffer, sizeof(buffer))) > 0;)
+        text.append(buffer, n);
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return false;
+    out << text << ",\"peakRssKB\":" << usage.ru_maxrss << "}\n";
+    out.flush();
+    return true;
+}
+
+static std::vector<std::string> splitList(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream tokens(list);
+    for (std::string token; std::getline(tokens, token, ',');)
+    {
+        if (!token.empty())
+            items.push_back(token);
+    }
+    return items;
+}
+
+int main(int argc, char **argv)
+{
+    auto moduleNameVec =
+            OptionBase::parseOptions(argc, argv, "CFL-reachability solver benchmark",
+                                     "[options] [<input-bitcode...>]");
+    WorkOrder order;
+    if (!parseWorkOrder(BenchOrder(), order))
+    {
+        std::cout << "unknown -bench-order '" << BenchOrder()
+                  << "', expected fifo, lifo, per-label, label-priority or topological\n";
+        return 1;
+    }
+    if (BenchMode() != "worklist" && BenchMode() != "semi-naive")
+    {
+        std::cout << "unknown -bench-mode '" << BenchMode() << "', expected worklist or semi-naive\n";
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!BenchOutput().empty())
+    {
+        file.open(BenchOutput(), std::ios::app);
+        if (!file)
+        {
+            std::cout << "error opening " + BenchOutput() + "!!\n";
+            return 1;
+        }
+    }
+    std::ostream &out = BenchOutput().empty() ? std::cout : file;
+    unsigned repeat = std::max(BenchRepeat(), 1u);
+
+    // Every program runs in a child process of its own, see runIsolated
+    // Bitcode: the PAG is built once, the graph from it in every run
+    if (!moduleNameVec.empty() && !runIsolated(out, [&](std::ostream &line) {
+        Phase pagPhase{"pag"}, graph{"graph"}, solve{"solve"}, dump{"dump"};
+        Work work;
+        auto start = std::chrono::steady_clock::now();
+        LLVMModuleSet::buildSVFModule(moduleNameVec);
+        SVFIRBuilder builder;
+        auto pag = builder.build();
+        pagPhase.ms.push_back(elapsedMs(start));
+        pagPhase.edges = pag->getPAGEdgeNum();
+
+        std::string name = pag->getModuleIdentifier() + ".bench";
+        for (unsigned run = 0; run < repeat; ++run)
+            runOnce(name, [&](CFLR &solver) { solver.buildGraph(pag); }, graph, solve, dump, work);
+        std::vector<Phase> phases{pagPhase, graph, solve, dump};
+        report(line, pag->getModuleIdentifier(), pag->getTotalNodeNum(), pag->getPAGEdgeNum(), phases, work);
+        LLVMModuleSet::releaseLLVMModuleSet();
+        return true;
+    }))
+        return 1;
+
+    // Edge lists: reading the file takes the place of building the PAG
+    for (const std::string &fname : splitList(BenchEdges()))
+    {
+        if (!runIsolated(out, [&](std::ostream &line) {
+            Phase read{"read"}, graph{"graph"}, solve{"solve"}, dump{"dump"};
+            Work work;
+            std::vector<CFLREdge> stmts;
+            auto start = std::chrono::steady_clock::now();
+            if (!EdgeList::read(fname, stmts))
+                return false;
+            read.ms.push_back(elapsedMs(start));
+            read.edges = stmts.size();
+
+            for (unsigned run = 0; run < repeat; ++run)
+                runOnce(fname + ".bench", [&](CFLR &solver) { solver.buildGraph(stmts); }, graph, solve, dump, work);
+            std::vector<Phase> phases{read, graph, solve, dump};
+            report(line, fname, 0, stmts.size(), phases, work);
+            return true;
+        }))
+            return 1;
+    }
+
+    for (const std::string &kind : splitList(BenchSynthetic()))
+    {
+        for (const std::string &sizeText : splitList(BenchSizes()))
+        {
+            unsigned size = std::strtoul(sizeText.c_str(), nullptr, 10);
+            if (!runIsolated(out, [&](std::ostream &line) {
+                std::vector<CFLREdge> stmts;
+                if (!SyntheticGraphs::generate(kind, size, BenchSeed(), stmts))
+                {
+                    std::cout << "unknown synthetic program '" << kind << "', expected chain, web, list or random\n";
+                    return false;
+                }
+                Phase graph{"graph"}, solve{"solve"}, dump{"dump"};
+                Work work;
+                std::string name = "bench-" + kind + "-" + sizeText;
+                for (unsigned run = 0; run < repeat; ++run)
+                    runOnce(name, [&](CFLR &solver) { solver.buildGraph(stmts); }, graph, solve, dump, work);
+                std::vector<Phase> phases{graph, solve, dump};
+                report(line, kind, size, stmts.size(), phases, work);
+                return true;
+            }))
+                return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+/**
+ * CFLRGen.cpp
+ *
+ * Writes a synthetic program as an edge-list file (see EdgeList.h) for cflr -cflr-edges and
+ * cflr-bench -bench-edges, so the solver can be stressed at any size without bitcode.
+ */
+
+#include "EdgeList.h"
+#include "SyntheticGraphs.h"
+
+#include <cstdlib>
+
+using namespace SVF;
+using namespace llvm;
+using namespace std;
+
+static const Option<std::string> GenProgram(
+        "gen-program",
+        "Program to generate: random, chain, web or list",
+        "random");
+
+static const Option<u32_t> GenSize(
+        "gen-size",
+        "Number of pointers",
+        1000000);
+
+static const Option<u32_t> GenObjects(
+        "gen-objects",
+        "Number of objects of a random program (0: a tenth of the pointers)",
+        0);
+
+static const Option<std::string> GenCopies(
+        "gen-copies",
+        "Copy statements per pointer of a random program",
+        "1.0");
+
+static const Option<std::string> GenLoads(
+        "gen-loads",
+        "Load statements per pointer of a random program",
+        "0.2");
+
+static const Option<std::string> GenStores(
+        "gen-stores",
+        "Store statements per pointer of a random program",
+        "0.1");
+
+static const Option<u32_t> GenFunctionSize(
+        "gen-function-size",
+        "Pointers per function of a random program",
+        16);
+
+static const Option<std::string> GenCrossing(
+        "gen-crossing",
+        "Share of the copies of a random program from a pointer of another function",
+        "0.01");
+
+static const Option<std::string> GenSkew(
+        "gen-skew",
+        "Zipf exponent of how often each pointer of a random program is used",
+        "1.2");
+
+static const Option<u32_t> GenSeed(
+        "gen-seed",
+        "Seed of the random programs",
+        1);
+
+static const Option<std::string> GenOutput(
+        "gen-output",
+        "Edge-list file to write",
+        "");
+
+/// Parse a nonnegative decimal number of option name
+static bool parseNumber(const std::string &name, const std::string &text, double &number)
+{
+    char *end = nullptr;
+    number = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !(number >= 0))
+    {
+        std::cout << "bad number '" << text << "' for -" << name << "\n";
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    OptionBase::parseOptions(argc, argv, "Synthetic program generator for the CFL-reachability solver",
+                             "[options] -gen-output=<edge-list>");
+    if (GenOutput().empty())
+    {
+        std::cout << "no -gen-output file given\n";
+        return 1;
+    }
+
+    std::vector<CFLREdge> stmts;
+    if (GenProgram() == "random")
+    {
+        SyntheticGraphs::RandomProgram shape;
+        shape.pointers = GenSize();
+        shape.objects = GenObjects() ? GenObjects() : std::max(GenSize() / 10, 1u);
+        shape.functionSize = GenFunctionSize();
+        shape.seed = GenSeed();
+        if (!parseNumber("gen-copies", GenCopies(), shape.copies) ||
+            !parseNumber("gen-loads", GenLoads(), shape.loads) ||
+            !parseNumber("gen-stores", GenStores(), shape.stores) ||
+            !parseNumber("gen-crossing", GenCrossing(), shape.crossing) ||
+            !parseNumber("gen-skew", GenSkew(), shape.skew))
+            return 1;
+        if (shape.crossing > 1)
+        {
+            std::cout << "-gen-crossing is a share, between 0 and 1\n";
+            return 1;
+        }
+        stmts = SyntheticGraphs::randomProgram(shape);
+    }
+    else if (!SyntheticGraphs::generate(GenProgram(), GenSize(), GenSeed(), stmts))
+    {
+        std::cout << "unknown -gen-program '" << GenProgram() << "', expected random, chain, web or list\n";
+        return 1;
+    }
+
+    if (!EdgeList::write(GenOutput(), stmts))
+        return 1;
+    std::cout << stmts.size() << " statements written to " << GenOutput() << "\n";
+    return 0;
+}
@@ -0,0 +1,1013 @@
+/**
+ * CFLRSolver.cpp
+ * @author kisslune 
+ */
+
+#include "A4Header.h"
+#include "RuleKernels.h"
+
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace SVF;
+using namespace llvm;
+using namespace std;
+
+void CFLR::setGrammar(const CFLGrammar &g)
+{
+    grammar = g;
+    grammar.normalize();
+    // 文法与编译期生成的内核一致时，用内核代替按表解释执行
+    ruleKernels = grammar.sameRules(PointsToKernels::grammar());
+}
+
+
+void CFLR::layOutLabels(bool demandDriven, bool rederiving)
+{
+    const unsigned labelNum = grammar.getLabelNum();
+    std::vector<unsigned> directions(labelNum, 0);
+    for (EdgeLabel A = 0; A < labelNum; ++A)
+    {
+        // A ::= B C：joinSuccessors 查 C 的后继，joinPredecessors 查 B 的前驱
+        // 按需展开与 DRed 的重新推导还要从 x 沿 B 向前找
+        for (const auto &rule : grammar.getHeadRules(A))
+        {
+            directions[rule.right] |= CFLRGraph::Forward;
+            directions[rule.left] |= CFLRGraph::Backward;
+            if (demandDriven || rederiving)
+                directions[rule.left] |= CFLRGraph::Forward;
+        }
+        // A ::= B：按需展开时查 B 的后继，否则只需判断边是否存在
+        for (EdgeLabel B : grammar.getUnaryBodies(A))
+        {
+            if (demandDriven)
+                directions[B] |= CFLRGraph::Forward;
+        }
+    }
+    // 结果按 PT 后继输出；合并结点时要搬动被合并结点两个方向的边
+    if (PT < labelNum)
+        directions[PT] |= CFLRGraph::Forward;
+    // 镜像标签的方向反过来归到其存储标签上
+    for (EdgeLabel label = 0; label < labelNum; ++label)
+    {
+        EdgeLabel stored = graph->getStoredLabel(label);
+        if (stored != label && stored < labelNum)
+            directions[stored] |= CFLRGraph::reverseDirections(directions[label]);
+    }
+    graph->reserveLabels(labelNum);
+    for (EdgeLabel label = 0; label < labelNum; ++label)
+    {
+        if (graph->getStoredLabel(label) == label)
+            graph->setLabelDirections(label, cycleCollapsing ? CFLRGraph::BothDirections : directions[label]);
+    }
+}
+
+
+void CFLR::addEdgeToWorklist(unsigned src, unsigned dst, EdgeLabel label)
+{
+    if (cycleCollapsing)
+    {
+        src = nodeReps.find(src);
+        dst = nodeReps.find(dst);
+    }
+    if (!graph->insertIfAbsent(src, dst, label))
+    {
+        CFLR_STAT(stats.countDuplicate(label));
+        return;
+    }
+    // 镜像标签的边以其存储标签的反向边入表，弹出时两者一并处理
+    if (graph->getStoredLabel(label) != label)
+    {
+        std::swap(src, dst);
+        label = graph->getStoredLabel(label);
+    }
+    workList.push(CFLREdge(src, dst, label));
+    CFLR_STAT(stats.countDerived(), stats.countPush(label, workList.size()));
+
+    // VF 双向成立时两端在同一个环上，留待主循环合并
+    if (cycleCollapsing && label == VF && src != dst && graph->hasEdge(dst, src, VF))
+        pendingMerges.emplace_back(src, dst);
+}
+
+
+void CFLR::joinSuccessors(unsigned x, unsigned z, EdgeLabel C, EdgeLabel A)
+{
+    // 两个标签都以位集存储时整字求并，只把新置位的边加入工作表
+    // 合并结点时行中可能留有被合并的旧结点，需逐个换成代表结点，不能整行求并
+    // 位集求并只产生新置位的边，统计中探查数即新边数
+    nbrs.clear();
+    if (!cycleCollapsing && graph->unionSuccessors(x, A, z, C, nbrs))
+    {
+        for (auto w : nbrs)
+        {
+            workList.push(CFLREdge(x, w, A));
+            CFLR_STAT(stats.countDerived(), stats.countPush(A, workList.size()));
+        }
+        CFLR_STAT(stats.countJoin(A, stats.getOperand(), C, nbrs.size(), nbrs.size()));
+        return;
+    }
+
+    // 邻接行在插入时可能被移动，因此先把邻居复制到缓冲区再遍历
+    CFLR_STAT(uint64_t derived = stats.getDerived());
+    graph->collectSuccessors(z, C, nbrs);
+    for (auto w : nbrs)
+        addEdgeToWorklist(x, w, A);
+    CFLR_STAT(stats.countJoin(A, stats.getOperand(), C, nbrs.size(), stats.getDerived() - derived));
+}
+
+
+void CFLR::joinPredecessors(unsigned x, unsigned z, EdgeLabel B, EdgeLabel A)
+{
+    CFLR_STAT(uint64_t derived = stats.getDerived());
+    nbrs.clear();
+    graph->collectPredecessors(x, B, nbrs);
+    for (auto y : nbrs)
+        addEdgeToWorklist(y, z, A);
+    CFLR_STAT(stats.countJoin(A, B, stats.getOperand(), nbrs.size(), stats.getDerived() - derived));
+}
+
+
+
+void CFLR::joinEdge(const CFLREdge &edge)
+{
+    if (ruleKernels)
+        PointsToKernels::apply(*this, edge);
+    else
+        applyProductionRules(edge);
+
+    // 标签对只存一次时，一条边同时代表其反向的镜像边
+    EdgeLabel reverse = graph->getReverseLabel(edge.label);
+    if (reverse == edge.label)
+        return;
+    CFLREdge mirror(edge.dst, edge.src, reverse);
+    if (ruleKernels)
+        PointsToKernels::apply(*this, mirror);
+    else
+        applyProductionRules(mirror);
+}
+
+
+void CFLR::applyProductionRules(const CFLREdge &edge)
+{
+    unsigned x = edge.src;
+    unsigned z = edge.dst;
+
+    // A ::= B
+    for (EdgeLabel A : grammar.getUnaryHeads(edge.label))
+        applyUnaryRule(x, z, edge.label, A);
+
+    // A ::= B C，新边是 B (x -B-> z)：找所有 z -C-> w，添加 x -A-> w
+    for (const auto &rule : grammar.getLeftRules(edge.label))
+        joinSuccessors(x, z, rule.other, rule.head);
+
+    // A ::= B C，新边是 C (x -C-> z)：找所有 y -B-> x，添加 y -A-> z
+    for (const auto &rule : grammar.getRightRules(edge.label))
+        joinPredecessors(x, z, rule.other, rule.head);
+}
+
+
+/// Edges popped between two looks at the clock for a checkpoint
+static constexpr size_t CheckpointStride = 4096;
+
+void CFLR::solve()
+{
+    if (solved)
+        return;
+    layOutLabels(false, false);
+    // 按优先级出队的顺序在开始求解时排定标签或结点的次序，须在任何边入表之前
+    if (workList.getOrder() == WorkOrder::LabelPriority)
+        workList.setLabelRanks(rankLabels());
+    else if (workList.getOrder() == WorkOrder::Topological)
+    {
+        CFLR_STAT(auto timer = stats.time("rank"));
+        workList.setNodeRanks(rankNodes());
+    }
+    if (cycleCollapsing)
+    {
+        CFLR_STAT(auto timer = stats.time("collapse"));
+        collapseCopyCycles();
+    }
+
+    // 将图中所有已存在的边加入工作表；从快照恢复时只需加入其中尚未处理的边
+    // 规范化后的文法已把 epsilon 折叠进一元规则，无需为每个节点添加自环
+    if (resuming)
+    {
+        for (const CFLREdge &edge : pendingEdges)
+        {
+            workList.push(edge);
+            CFLR_STAT(stats.countPush(edge.label, workList.size()));
+        }
+        pendingEdges.clear();
+        resuming = false;
+    }
+    else
+    {
+        graph->forEachEdge([&](unsigned src, unsigned dst, EdgeLabel label) {
+            workList.push(CFLREdge(src, dst, label));
+            CFLR_STAT(stats.countPush(label, workList.size()));
+        });
+    }
+    if (!propagate())
+        return;
+
+    solved = true;
+    if (!snapshotFile.empty())
+        saveSnapshot({}, true);
+}
+
+
+bool CFLR::propagate()
+{
+    // 主循环：动态规划 CFL 可达性算法，每条边只访问以其标签为操作数的产生式
+    CFLR_STAT(auto timer = stats.time("propagate"));
+    startBudget();
+    std::vector<CFLREdge> pending;
+    for (size_t popped = 0; !workList.empty(); ++popped)
+    {
+        // 定期保存快照：图中的边要么已处理，要么仍在工作表中
+        if (popped % CheckpointStride == 0 && checkpointDue())
+        {
+            pending.clear();
+            workList.forEach([&](const CFLREdge &edge) { pending.push_back(edge); });
+            saveSnapshot(pending, false);
+        }
+        // 预算用尽时停下，工作表中的边留待下次求解
+        if (popped % CheckpointStride == 0 && budgetExhausted(workList.size()))
+        {
+            pending.clear();
+            workList.forEach([&](const CFLREdge &edge) { pending.push_back(edge); });
+            workList.clear();
+            stopAtBudget(pending);
+            return false;
+        }
+        CFLR_STAT(if (popped % CheckpointStride == 0) stats.sample(workList.size()));
+        CFLREdge edge = workList.pop();
+        CFLR_STAT(stats.countPop(edge.label));
+        // 端点已被合并的边不再处理，它已作为代表结点的边重新入表
+        if (cycleCollapsing && (!nodeReps.isRep(edge.src) || !nodeReps.isRep(edge.dst)))
+            continue;
+        joinEdge(edge);
+
+        while (!pendingMerges.empty())
+        {
+            auto nodes = pendingMerges.back();
+            pendingMerges.pop_back();
+            mergeNodes(nodes.first, nodes.second);
+        }
+    }
+    return true;
+}
+
+
+namespace
+{
+/// Resident set size of the process in MiB
+size_t residentMB()
+{
+    // statm 的第二项是驻留页数；读不到时退而取峰值
+    std::ifstream statm("/proc/self/statm");
+    size_t pages, resident;
+    if (statm >> pages >> resident)
+        return resident * ::sysconf(_SC_PAGESIZE) >> 20;
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss >> 10;
+}
+}
+
+
+void CFLR::startBudget()
+{
+    stopReason.clear();
+    solveStart = lastProgress = std::chrono::steady_clock::now();
+    lastProgressEdges = progressInterval ? countEdges() : 0;
+}
+
+
+bool CFLR::budgetExhausted(size_t pendingNum)
+{
+    if (!timeBudget && !memoryBudget && !progressInterval)
+        return false;
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - solveStart).count();
+    size_t resident = 0;
+
+    if (progressInterval && now - lastProgress >= std::chrono::seconds(progressInterval))
+    {
+        size_t edges = countEdges();
+        double span = std::chrono::duration<double>(now - lastProgress).count();
+        resident = residentMB();
+        std::cout << "[cflr] " << (unsigned) elapsed << " s: " << edges << " edges, "
+                  << (size_t) ((edges - std::min(edges, lastProgressEdges)) / span) << " edges/s, "
+                  << pendingNum << " to join, " << resident << " MiB resident\n" << std::flush;
+        lastProgress = now;
+        lastProgressEdges = edges;
+    }
+
+    if (timeBudget && elapsed >= timeBudget)
+        stopReason = "time budget of " + std::to_string(timeBudget) + " s";
+    else if (memoryBudget && (resident ? resident : residentMB()) >= memoryBudget)
+        stopReason = "memory budget of " + std::to_string(memoryBudget) + " MiB";
+    return !stopReason.empty();
+}
+
+
+void CFLR::stopAtBudget(std::vector<CFLREdge> &pending)
+{
+    // 与从快照恢复相同：图中除待处理边外的边都已连接过，再次求解时只需从待处理边出发
+    pendingEdges.swap(pending);
+    resuming = true;
+    solved = false;
+    if (!snapshotFile.empty())
+        saveSnapshot(pendingEdges, false);
+    std::cout << "[cflr] stopped at the " << stopReason << " with " << pendingEdges.size()
+              << " edges left to join; the results are incomplete\n" << std::flush;
+}
+
+
+size_t CFLR::countEdges() const
+{
+    size_t num = 0;
+    for (EdgeLabel label = 0; label < grammar.getLabelNum(); ++label)
+        num += graph->getEdgeNum(label);
+    return num;
+}
+
+
+bool CFLR::addPAGEdges(const std::vector<CFLREdge> &edges)
+{
+    // 值编号合并的结点在新边下未必仍然等价
+    if (substitution || !demanded.empty())
+        return false;
+    // 快照以初始图为键，更新后的图不再与之对应
+    snapshotFile.clear();
+
+    // 尚未求解时只需把边加入图中；否则新边入表，从已有的不动点继续推导
+    // 待恢复时求解只从待处理边出发，新边也要加入其中
+    for (const CFLREdge &edge : edges)
+    {
+        for (const CFLREdge &e : {edge, CFLREdge(edge.dst, edge.src, edge.label + 1)})
+        {
+            if (solved)
+                addEdgeToWorklist(e.src, e.dst, e.label);
+            else if (graph->insertIfAbsent(e.src, e.dst, e.label) && resuming)
+                pendingEdges.push_back(e);
+        }
+    }
+    if (solved)
+        propagate();
+    return true;
+}
+
+
+bool CFLR::removePAGEdges(const std::vector<CFLREdge> &edges)
+{
+    // 合并过的结点与值编号都可能因删边而失效；待恢复的图中派生边与待处理边无法区分
+    if (substitution || cycleCollapsing || !demanded.empty() || resuming)
+        return false;
+    snapshotFile.clear();
+
+    // doomed：被过度删除的边，先是删去的基本边
+    std::vector<CFLREdge> doomed;
+    std::unordered_set<CFLREdge> marked;
+    for (const CFLREdge &edge : edges)
+    {
+        for (const CFLREdge &e : {edge, CFLREdge(edge.dst, edge.src, edge.label + 1)})
+        {
+            if (graph->hasEdge(e.src, e.dst, e.label) && marked.insert(e).second)
+                doomed.push_back(e);
+        }
+    }
+    if (!solved)
+    {
+        for (const CFLREdge &e : doomed)
+            graph->removeEdge(e.src, e.dst, e.label);
+        return true;
+    }
+    layOutLabels(false, true);
+
+    // 过度删除：在删除前的图上，凡有一个推导用到被删边的边都删去
+    auto doom = [&](unsigned src, unsigned dst, EdgeLabel label) {
+        CFLREdge e(src, dst, label);
+        if (graph->hasEdge(src, dst, label) && marked.insert(e).second)
+            doomed.push_back(e);
+    };
+    std::vector<unsigned> nodes;
+    for (size_t i = 0; i < doomed.size(); ++i)
+    {
+        CFLREdge edge = doomed[i];
+        for (EdgeLabel A : grammar.getUnaryHeads(edge.label))
+            doom(edge.src, edge.dst, A);
+        // A ::= B C，x -B-> z：删去 x -A-> w，其中 z -C-> w
+        for (const auto &rule : grammar.getLeftRules(edge.label))
+        {
+            nodes.clear();
+            graph->collectSuccessors(edge.dst, rule.other, nodes);
+            for (auto w : nodes)
+                doom(edge.src, w, rule.head);
+        }
+        // A ::= C B，z -B-> w：删去 x -A-> w，其中 x -C-> z
+        for (const auto &rule : grammar.getRightRules(edge.label))
+        {
+            nodes.clear();
+            graph->collectPredecessors(edge.src, rule.other, nodes);
+            for (auto x : nodes)
+                doom(x, edge.dst, rule.head);
+        }
+    }
+    for (const CFLREdge &e : doomed)
+        graph->removeEdge(e.src, e.dst, e.label);
+
+    // 重新推导：剩余的图中仍能一步推出的边重新入表，再传播到不动点
+    for (const CFLREdge &e : doomed)
+    {
+        bool derivable = false;
+        for (EdgeLabel B : grammar.getUnaryBodies(e.label))
+            derivable |= graph->hasEdge(e.src, e.dst, B);
+        for (const auto &rule : grammar.getHeadRules(e.label))
+        {
+            if (derivable)
+                break;
+            nodes.clear();
+            graph->collectSuccessors(e.src, rule.left, nodes);
+            for (auto z : nodes)
+                derivable |= graph->hasEdge(z, e.dst, rule.right);
+        }
+        if (derivable)
+            addEdgeToWorklist(e.src, e.dst, e.label);
+    }
+    propagate();
+    return true;
+}
+
+
+bool CFLR::useCycleCollapsing()
+{
+    // 只对指向分析文法成立：VF 环上的指针结点在各标签下可互换
+    if (!ruleKernels)
+        return false;
+    cycleCollapsing = true;
+    return true;
+}
+
+
+void CFLR::mergeNodes(unsigned x, unsigned y)
+{
+    x = nodeReps.find(x);
+    y = nodeReps.find(y);
+    if (x == y || graph->isObjectNode(x) || graph->isObjectNode(y))
+        return;
+    unsigned rep = nodeReps.unite(x, y);
+    unsigned gone = rep == x ? y : x;
+
+    // 把被合并结点的出边、入边都挂到代表结点上，新边照常入表处理
+    // 镜像标签的边随其存储标签一起搬动
+    std::vector<unsigned> nodes;
+    for (EdgeLabel label = 0; label < grammar.getLabelNum(); ++label)
+    {
+        if (graph->getStoredLabel(label) != label)
+            continue;
+        nodes.clear();
+        graph->collectSuccessors(gone, label, nodes);
+        for (auto w : nodes)
+            addEdgeToWorklist(rep, w, label);
+        nodes.clear();
+        graph->collectPredecessors(gone, label, nodes);
+        for (auto w : nodes)
+            addEdgeToWorklist(w, rep, label);
+    }
+}
+
+
+void CFLR::collapseCopyCycles()
+{
+    // 跳过对象结点；每个强连通分量并入其中第一个结点
+    unsigned nodeNum = graph->getNodeNum();
+    std::vector<bool> objects(nodeNum);
+    for (unsigned node = 0; node < nodeNum; ++node)
+        objects[node] = graph->isObjectNode(node);
+    unsigned sccNum;
+    std::vector<unsigned> sccs = findCopySCCs(nodeNum, objects, sccNum);
+    std::vector<unsigned> firsts(sccNum, NoSCC);
+    for (unsigned node = 0; node < nodeNum; ++node)
+    {
+        if (sccs[node] == NoSCC)
+            continue;
+        if (firsts[sccs[node]] == NoSCC)
+            firsts[sccs[node]] = node;
+        else
+            mergeNodes(firsts[sccs[node]], node);
+    }
+}
+
+
+std::vector<unsigned> CFLR::findCopySCCs(unsigned nodeNum, const std::vector<bool> &skip, unsigned &sccNum)
+{
+    // Copy 边的 CSR，按 Copy 保留的任一方向读出
+    auto skipped = [&](unsigned node) { return node >= nodeNum || (!skip.empty() && skip[node]); };
+    std::vector<size_t> offsets(nodeNum + 1, 0);
+    graph->forEachEdge(Copy, [&](unsigned src, unsigned dst) {
+        if (!skipped(src) && !skipped(dst))
+            ++offsets[src + 1];
+    });
+    for (unsigned node = 0; node < nodeNum; ++node)
+        offsets[node + 1] += offsets[node];
+    std::vector<unsigned> targets(offsets[nodeNum]);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    graph->forEachEdge(Copy, [&](unsigned src, unsigned dst) {
+        if (!skipped(src) && !skipped(dst))
+            targets[fill[src]++] = dst;
+    });
+
+    // 迭代实现的 Tarjan 算法；order 为 0 表示未访问
+    std::vector<unsigned> sccs(nodeNum, NoSCC);
+    std::vector<unsigned> order(nodeNum, 0), low(nodeNum, 0);
+    std::vector<bool> onStack(nodeNum, false);
+    std::vector<unsigned> stack;
+    std::vector<std::pair<unsigned, size_t>> frames;    // 结点与下一条待访问的出边
+    unsigned visited = 0;
+    sccNum = 0;
+    auto visit = [&](unsigned node) {
+        order[node] = low[node] = ++visited;
+        stack.push_back(node);
+        onStack[node] = true;
+        frames.emplace_back(node, offsets[node]);
+    };
+
+    for (unsigned root = 0; root < nodeNum; ++root)
+    {
+        if (order[root] || skipped(root))
+            continue;
+        visit(root);
+        while (!frames.empty())
+        {
+            unsigned v = frames.back().first;
+            if (frames.back().second < offsets[v + 1])
+            {
+                unsigned w = targets[frames.back().second++];
+                if (!order[w])
+                    visit(w);
+                else if (onStack[w])
+                    low[v] = std::min(low[v], order[w]);
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty())
+                low[frames.back().first] = std::min(low[frames.back().first], low[v]);
+            if (low[v] != order[v])
+                continue;
+            // v 是一个强连通分量的根，它可达的分量都已编号
+            unsigned w;
+            do
+            {
+                w = stack.back();
+                stack.pop_back();
+                onStack[w] = false;
+                sccs[w] = sccNum;
+            } while (w != v);
+            ++sccNum;
+        }
+    }
+    return sccs;
+}
+
+
+std::vector<unsigned> CFLR::rankLabels() const
+{
+    // 一元规则的体与闭包规则（A ::= A B、A ::= B A）的操作数先处理，其余连接（如 Store/Load）其后
+    std::vector<unsigned> ranks(grammar.getLabelNum(), 1);
+    for (const auto &rule : grammar.getUnaryRules())
+        ranks[rule.body] = 0;
+    for (const auto &rule : grammar.getBinaryRules())
+    {
+        if (rule.head == rule.left || rule.head == rule.right)
+            ranks[rule.left] = ranks[rule.right] = 0;
+    }
+    return ranks;
+}
+
+
+std::vector<unsigned> CFLR::rankNodes()
+{
+    // 分量按完成顺序编号，汇点在先；反过来即拓扑序，源点在先
+    unsigned nodeNum = graph->getNodeNum();
+    unsigned sccNum;
+    std::vector<unsigned> ranks = findCopySCCs(nodeNum, {}, sccNum);
+    for (unsigned &rank : ranks)
+        rank = sccNum - 1 - rank;
+    return ranks;
+}
+
+
+void CFLR::demand(unsigned node, EdgeLabel label)
+{
+    if (label >= demanded.size())
+        demanded.resize(label + 1);
+    std::vector<bool> &nodes = demanded[label];
+    if (node >= nodes.size())
+        nodes.resize(node + 1, false);
+    if (nodes[node])
+        return;
+    nodes[node] = true;
+    demandList.push({node, label});
+}
+
+
+void CFLR::expandDemand(unsigned x, EdgeLabel A)
+{
+    std::vector<unsigned> mids;
+
+    // A ::= B：需要 x 的 B 后继，已有的 x -B-> z 直接得到 x -A-> z
+    for (EdgeLabel B : grammar.getUnaryBodies(A))
+    {
+        demand(x, B);
+        mids.clear();
+        graph->collectSuccessors(x, B, mids);
+        for (auto z : mids)
+            addEdgeToWorklist(x, z, A);
+    }
+
+    // A ::= B C：需要 x 的 B 后继，以及每个已有的 x -B-> z 中 z 的 C 后继
+    for (const auto &rule : grammar.getHeadRules(A))
+    {
+        demand(x, rule.left);
+        mids.clear();
+        graph->collectSuccessors(x, rule.left, mids);
+        for (auto z : mids)
+        {
+            demand(z, rule.right);
+            nbrs.clear();
+            graph->collectSuccessors(z, rule.right, nbrs);
+            for (auto w : nbrs)
+                addEdgeToWorklist(x, w, A);
+        }
+    }
+}
+
+
+void CFLR::applyDemandedRules(const CFLREdge &edge)
+{
+    unsigned x = edge.src;
+    unsigned z = edge.dst;
+
+    // A ::= B，仅当 x 的 A 后继被需要
+    for (EdgeLabel A : grammar.getUnaryHeads(edge.label))
+    {
+        if (isDemanded(A, x))
+            addEdgeToWorklist(x, z, A);
+    }
+
+    // A ::= B C，新边是 B (x -B-> z)：x 的 A 后继被需要时，z 的 C 后继也被需要
+    for (const auto &rule : grammar.getLeftRules(edge.label))
+    {
+        if (!isDemanded(rule.head, x))
+            continue;
+        demand(z, rule.other);
+        nbrs.clear();
+        graph->collectSuccessors(z, rule.other, nbrs);
+        for (auto w : nbrs)
+            addEdgeToWorklist(x, w, rule.head);
+    }
+
+    // A ::= B C，新边是 C (x -C-> z)：只与 A 后继被需要的 y -B-> x 连接
+    for (const auto &rule : grammar.getRightRules(edge.label))
+    {
+        nbrs.clear();
+        graph->collectPredecessors(x, rule.other, nbrs);
+        for (auto y : nbrs)
+        {
+            if (isDemanded(rule.head, y))
+                addEdgeToWorklist(y, z, rule.head);
+        }
+    }
+}
+
+
+void CFLR::query(unsigned node, EdgeLabel label)
+{
+    // 图中已有的边不入工作表：需求展开时会查看它们；先展开需求，再处理新边
+    if (solved)
+        return;
+    layOutLabels(true, false);
+    demand(getGraphNode(node), label);
+    while (!demandList.empty() || !workList.empty())
+    {
+        if (!demandList.empty())
+        {
+            auto next = demandList.pop();
+            expandDemand(next.first, next.second);
+        }
+        else
+        {
+            CFLREdge edge = workList.pop();
+            CFLR_STAT(stats.countPop(edge.label));
+            applyDemandedRules(edge);
+            EdgeLabel reverse = graph->getReverseLabel(edge.label);
+            if (reverse != edge.label)
+                applyDemandedRules(CFLREdge(edge.dst, edge.src, reverse));
+        }
+    }
+}
+
+
+namespace
+{
+/**
+ * One task deque per thread. A thread takes tasks from the back of its own deque and,
+ * once that is empty, steals from the front of the others.
+ */
+class TaskDeques
+{
+public:
+    explicit TaskDeques(unsigned threadNum) : deques(threadNum)
+    {}
+
+    void push(unsigned thread, size_t task)
+    {
+        std::lock_guard<std::mutex> guard(deques[thread].lock);
+        deques[thread].tasks.push_back(task);
+    }
+
+    bool pop(unsigned thread, size_t &task)
+    {
+        for (unsigned i = 0; i < deques.size(); ++i)
+        {
+            Deque &deque = deques[(thread + i) % deques.size()];
+            std::lock_guard<std::mutex> guard(deque.lock);
+            if (deque.tasks.empty())
+                continue;
+            if (i == 0)
+            {
+                task = deque.tasks.back();
+                deque.tasks.pop_back();
+            }
+            else
+            {
+                task = deque.tasks.front();
+                deque.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Deque
+    {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    std::deque<Deque> deques;
+};
+
+
+/// Run work(thread, task) for every task in [0, taskNum) on threadNum threads
+template<class F>
+void runTasks(unsigned threadNum, size_t taskNum, F work)
+{
+    if (threadNum <= 1 || taskNum <= 1)
+    {
+        for (size_t task = 0; task < taskNum; ++task)
+            work(0, task);
+        return;
+    }
+
+    TaskDeques deques(threadNum);
+    for (size_t task = 0; task < taskNum; ++task)
+        deques.push(task % threadNum, task);
+    std::vector<std::thread> threads;
+    for (unsigned thread = 0; thread < threadNum; ++thread)
+    {
+        threads.emplace_back([&, thread] {
+            size_t task;
+            while (deques.pop(thread, task))
+                work(thread, task);
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+}
+
+
+/// A slice of one label's delta, joined through the rules where the label is the left or right operand
+struct JoinTask
+{
+    EdgeLabel label;
+    bool left;
+    size_t begin;
+    size_t end;
+};
+
+constexpr size_t JoinChunkSize = 1024;
+constexpr unsigned ShardsPerThread = 8;
+}
+
+
+void CFLR::solveSemiNaive(unsigned threadNum)
+{
+    if (solved)
+        return;
+    CFLR_STAT(auto timer = stats.time("semi-naive"));
+    startBudget();
+    threadNum = std::max(threadNum, 1u);
+    const unsigned labelNum = grammar.getLabelNum();
+    layOutLabels(false, false);
+    if (threadNum > 1)
+        graph->setShardNum(threadNum * ShardsPerThread);
+
+    // delta[B]：上一轮新加入的 B 边，按源点排序；byDst[B] 为按目标排序的副本
+    // 从快照恢复时，第一轮的 delta 是快照中尚未连接的边
+    // 镜像标签的边只记在其存储标签的 delta 中，每轮开始时再反向复制一份
+    std::vector<std::vector<CFLREdge>> delta(labelNum), byDst(labelNum);
+    auto stored = [&](const CFLREdge &edge) {
+        EdgeLabel label = graph->getStoredLabel(edge.label);
+        return label == edge.label ? edge : CFLREdge(edge.dst, edge.src, label);
+    };
+    auto collectPending = [&]() {
+        std::vector<CFLREdge> pending;
+        for (EdgeLabel label = 0; label < labelNum; ++label)
+        {
+            if (graph->getStoredLabel(label) == label)
+                pending.insert(pending.end(), delta[label].begin(), delta[label].end());
+        }
+        return pending;
+    };
+    if (resuming)
+    {
+        for (const CFLREdge &edge : pendingEdges)
+            delta[graph->getStoredLabel(edge.label)].push_back(stored(edge));
+        pendingEdges.clear();
+        resuming = false;
+    }
+    else
+    {
+        graph->forEachEdge([&](unsigned src, unsigned dst, EdgeLabel label) {
+            delta[label].push_back(CFLREdge(src, dst, label));
+        });
+    }
+
+    // derived[t][A]：线程 t 本轮推导出的 A 边；fresh[t][A]：其中由线程 t 插入图中的新边
+    std::vector<std::vector<std::vector<CFLREdge>>> derived(
+            threadNum, std::vector<std::vector<CFLREdge>>(labelNum));
+    std::vector<std::vector<std::vector<CFLREdge>>> fresh(
+            threadNum, std::vector<std::vector<CFLREdge>>(labelNum));
+    std::vector<std::vector<unsigned>> partners(threadNum);
+    std::vector<JoinTask> tasks;
+
+    for (bool changed = true; changed;)
+    {
+        for (EdgeLabel label = 0; label < labelNum; ++label)
+        {
+            EdgeLabel from = graph->getStoredLabel(label);
+            if (from == label)
+                continue;
+            delta[label].clear();
+            for (const CFLREdge &edge : delta[from])
+                delta[label].emplace_back(edge.dst, edge.src, label);
+        }
+
+        // 每轮开始时压缩，使各行有序且连续；按标签分组排序 delta
+        runTasks(threadNum, labelNum, [&](unsigned, size_t label) {
+            graph->compact(label);
+            std::vector<CFLREdge> &edges = delta[label];
+            if (!grammar.getRightRules(label).empty())
+                std::sort(edges.begin(), edges.end());
+            if (!grammar.getLeftRules(label).empty())
+            {
+                byDst[label] = edges;
+                std::sort(byDst[label].begin(), byDst[label].end(), [](const CFLREdge &a, const CFLREdge &b) {
+                    return a.dst != b.dst ? a.dst < b.dst : a.src < b.src;
+                });
+            }
+        });
+
+        // 把每个标签的 delta 切成块，块边界落在连接结点的分组之间
+        tasks.clear();
+        for (EdgeLabel B = 0; B < labelNum; ++B)
+        {
+            for (bool left : {true, false})
+            {
+                const std::vector<CFLREdge> &edges = left ? byDst[B] : delta[B];
+                bool idle = left ? grammar.getLeftRules(B).empty()
+                                 : (grammar.getRightRules(B).empty() && grammar.getUnaryHeads(B).empty());
+                if (idle)
+                    continue;
+                for (size_t begin = 0, end; begin < edges.size(); begin = end)
+                {
+                    end = std::min(begin + JoinChunkSize, edges.size());
+                    while (end < edges.size() &&
+                           (left ? edges[end].dst == edges[end - 1].dst : edges[end].src == edges[end - 1].src))
+                        ++end;
+                    tasks.push_back({B, left, begin, end});
+                }
+            }
+        }
+
+        // 连接阶段：只读图，各线程把推导出的边写入自己的缓冲区
+        runTasks(threadNum, tasks.size(), [&](unsigned thread, size_t t) {
+            const JoinTask &task = tasks[t];
+            std::vector<std::vector<CFLREdge>> &out = derived[thread];
+            std::vector<unsigned> &nodes = partners[thread];
+            if (task.left)
+            {
+                // A ::= B C：x -B-> z 与 z 的 C 后继整组连接
+                const std::vector<CFLREdge> &edges = byDst[task.label];
+                for (size_t first = task.begin, last; first < task.end; first = last)
+                {
+                    unsigned z = edges[first].dst;
+                    for (last = first; last < task.end && edges[last].dst == z; ++last);
+                    for (const auto &rule : grammar.getLeftRules(task.label))
+                    {
+                        nodes.clear();
+                        graph->collectSuccessors(z, rule.other, nodes);
+                        for (size_t i = first; i < last; ++i)
+                        {
+                            for (auto w : nodes)
+                                out[rule.head].emplace_back(edges[i].src, w, rule.head);
+                        }
+                    }
+                }
+                return;
+            }
+
+            const std::vector<CFLREdge> &edges = delta[task.label];
+            // A ::= B
+            for (EdgeLabel A : grammar.getUnaryHeads(task.label))
+            {
+                for (size_t i = task.begin; i < task.end; ++i)
+                    out[A].emplace_back(edges[i].src, edges[i].dst, A);
+            }
+            // A ::= C B：x -B-> z 与 x 的 C 前驱整组连接
+            for (size_t first = task.begin, last; first < task.end; first = last)
+            {
+                unsigned x = edges[first].src;
+                for (last = first; last < task.end && edges[last].src == x; ++last);
+                for (const auto &rule : grammar.getRightRules(task.label))
+                {
+                    nodes.clear();
+                    graph->collectPredecessors(x, rule.other, nodes);
+                    for (auto y : nodes)
+                    {
+                        for (size_t i = first; i < last; ++i)
+                            out[rule.head].emplace_back(y, edges[i].dst, rule.head);
+                    }
+                }
+            }
+        });
+
+        // 插入阶段：图按结点分片加锁，各线程并发插入推导出的边，重复的边由 insertIfAbsent 过滤
+        runTasks(threadNum, threadNum * labelNum, [&](unsigned thread, size_t t) {
+            EdgeLabel A = t % labelNum;
+            std::vector<CFLREdge> &edges = derived[t / labelNum][A];
+            for (const CFLREdge &edge : edges)
+            {
+                if (graph->insertIfAbsent(edge.src, edge.dst, edge.label))
+                    fresh[thread][graph->getStoredLabel(A)].push_back(stored(edge));
+            }
+            edges.clear();
+        });
+
+        // 新边构成下一轮的 delta
+        for (EdgeLabel A = 0; A < labelNum; ++A)
+        {
+            delta[A].clear();
+            for (auto &out : fresh)
+            {
+                delta[A].insert(delta[A].end(), out[A].begin(), out[A].end());
+                out[A].clear();
+            }
+        }
+
+        changed = false;
+        size_t deltaNum = 0;
+        for (EdgeLabel label = 0; label < labelNum; ++label)
+        {
+            if (graph->getStoredLabel(label) != label)
+                continue;
+            changed |= !delta[label].empty();
+            deltaNum += delta[label].size();
+        }
+
+        // 预算用尽时停下，delta 留作待处理边
+        if (changed && budgetExhausted(deltaNum))
+        {
+            std::vector<CFLREdge> pending = collectPending();
+            stopAtBudget(pending);
+            return;
+        }
+
+        // 轮与轮之间保存快照：delta 之外的边已两两连接过
+        if (changed && checkpointDue())
+            saveSnapshot(collectPending(), false);
+    }
+
+    solved = true;
+    if (!snapshotFile.empty())
+        saveSnapshot({}, true);
+}
@@ -0,0 +1,115 @@
+/**
+ * EdgeList.cpp
+ */
+
+#include "EdgeList.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+const char *const LabelNames[] = {"Addr", "Copy", "Store", "Load"};
+const EdgeLabel Labels[] = {Addr, Copy, Store, Load};
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/// Parse a decimal node ID at text, moving text past it
+bool parseNode(const char *&text, unsigned &node)
+{
+    if (*text < '0' || *text > '9')
+        return false;
+    char *end;
+    unsigned long value = std::strtoul(text, &end, 10);
+    if (value > 0xffffffffUL || !(isBlank(*end) || *end == '\0'))
+        return false;
+    node = value;
+    text = end;
+    return true;
+}
+}
+
+
+bool EdgeList::read(const std::string &fname, std::vector<CFLREdge> &stmts)
+{
+    // Files run to millions of lines: read the whole file and parse it in place
+    std::ifstream inFile(fname, std::ios::binary);
+    if (!inFile)
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+
+    size_t lineNo = 0;
+    for (size_t pos = 0; pos < text.size();)
+    {
+        ++lineNo;
+        size_t eol = std::min(text.find('\n', pos), text.size());
+        auto comment = std::find(text.begin() + pos, text.begin() + eol, '#');
+        text[comment - text.begin()] = '\0';   // std::string keeps a '\0' at size() too
+        const char *cur = &text[pos];
+        pos = eol + 1;
+
+        while (isBlank(*cur))
+            ++cur;
+        if (*cur == '\0')
+            continue;
+
+        unsigned src, dst;
+        bool ok = parseNode(cur, src);
+        while (ok && isBlank(*cur))
+            ++cur;
+        ok = ok && parseNode(cur, dst);
+        while (ok && isBlank(*cur))
+            ++cur;
+        size_t nameLen = 0;
+        while (ok && cur[nameLen] != '\0' && !isBlank(cur[nameLen]))
+            ++nameLen;
+        int kind = -1;
+        for (int i = 0; ok && i < 4; ++i)
+        {
+            if (std::strlen(LabelNames[i]) == nameLen && std::strncmp(cur, LabelNames[i], nameLen) == 0)
+                kind = i;
+        }
+        cur += nameLen;
+        while (isBlank(*cur))
+            ++cur;
+        if (!ok || kind < 0 || *cur != '\0')
+        {
+            std::cout << fname << ":" << lineNo << ": expected '<src> <dst> Addr|Copy|Store|Load'\n";
+            return false;
+        }
+        stmts.emplace_back(src, dst, Labels[kind]);
+    }
+    return true;
+}
+
+
+bool EdgeList::write(const std::string &fname, const std::vector<CFLREdge> &stmts)
+{
+    FILE *outFile = std::fopen(fname.c_str(), "w");
+    if (!outFile)
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return false;
+    }
+    for (const CFLREdge &stmt : stmts)
+    {
+        const char *name = "Addr";
+        for (int i = 0; i < 4; ++i)
+        {
+            if (Labels[i] == stmt.label)
+                name = LabelNames[i];
+        }
+        std::fprintf(outFile, "%u %u %s\n", stmt.src, stmt.dst, name);
+    }
+    bool ok = !std::ferror(outFile);
+    return std::fclose(outFile) == 0 && ok;
+}
@@ -0,0 +1,37 @@
+/**
+ * EdgeList.h
+ *
+ * Programs as plain text, so that the solver can be run without SVF building a PAG.
+ * Every line holds one statement "src dst label", with node IDs in decimal and the label
+ * one of Addr, Copy, Store or Load, in the direction CFLRGraph takes them:
+ *
+ *     # p = &o; q = p; *q = r; s = *p
+ *     0 1 Addr
+ *     1 2 Copy
+ *     3 2 Store
+ *     1 4 Load
+ *
+ * '#' starts a comment; blank lines are skipped.
+ */
+
+#ifndef ANSWERS_EDGELIST_H
+#define ANSWERS_EDGELIST_H
+
+#include "A4Header.h"
+
+namespace EdgeList
+{
+/**
+ * Read the statements of an edge-list file, appending them to stmts
+ * @return false if the file cannot be read or has a malformed line
+ */
+bool read(const std::string &fname, std::vector<CFLREdge> &stmts);
+
+/**
+ * Write statements as an edge-list file
+ * @return false if the file cannot be written
+ */
+bool write(const std::string &fname, const std::vector<CFLREdge> &stmts);
+}
+
+#endif //ANSWERS_EDGELIST_H
@@ -0,0 +1,275 @@
+/**
+ * PointsToFile.cpp
+ */
+
+#include "PointsToFile.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr size_t FileBufferSize = 1 << 20;
+
+template<class T>
+inline void storeLittle(uint8_t *out, T value)
+{
+    for (size_t i = 0; i < sizeof(T); ++i)
+        out[i] = (uint8_t) (value >> (8 * i));
+}
+
+template<class T>
+inline T loadLittle(const uint8_t *in)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+        value |= (T) in[i] << (8 * i);
+    return value;
+}
+}
+
+
+PointsToFileWriter::PointsToFileWriter(const std::string &fname, unsigned nodeNum, uint32_t flags) :
+        nodeNum(nodeNum), flags(flags)
+{
+    file = std::fopen(fname.c_str(), "wb");
+    if (!file)
+        return;
+    std::setvbuf(file, nullptr, _IOFBF, FileBufferSize);
+
+    // Leave room for the header and the index, they are written by close()
+    offsets.reserve((size_t) nodeNum + 1);
+    std::vector<uint8_t> room(PointsToFile::HeaderSize + 8 * ((size_t) nodeNum + 1), 0);
+    writeBytes(room.data(), room.size());
+}
+
+
+PointsToFileWriter::~PointsToFileWriter()
+{
+    close();
+}
+
+
+void PointsToFileWriter::writePointsTo(unsigned src, const std::vector<unsigned> &dsts)
+{
+    if (!file || src < nextNode || src >= nodeNum)
+    {
+        failed = true;
+        return;
+    }
+    skipTo(src);
+    offsets.push_back(dataSize);
+    ++nextNode;
+
+    writeVarint(dsts.size());
+    unsigned last = 0;
+    for (unsigned dst : dsts)
+    {
+        writeVarint(dst - last);
+        last = dst;
+    }
+    edgeNum += dsts.size();
+}
+
+
+bool PointsToFileWriter::close()
+{
+    if (!file)
+        return !failed;
+
+    skipTo(nodeNum);
+    offsets.push_back(dataSize);
+
+    uint8_t header[PointsToFile::HeaderSize];
+    std::memcpy(header, PointsToFile::Magic, 8);
+    storeLittle<uint32_t>(header + 8, PointsToFile::Version);
+    storeLittle<uint32_t>(header + 12, nodeNum);
+    storeLittle<uint64_t>(header + 16, edgeNum);
+    storeLittle<uint32_t>(header + 24, flags);
+    storeLittle<uint32_t>(header + 28, 0);
+
+    if (std::fseek(file, 0, SEEK_SET) != 0)
+        failed = true;
+    writeBytes(header, sizeof(header));
+    uint8_t offset[8];
+    for (uint64_t value : offsets)
+    {
+        storeLittle<uint64_t>(offset, value);
+        writeBytes(offset, sizeof(offset));
+    }
+
+    failed |= std::fclose(file) != 0;
+    file = nullptr;
+    return !failed;
+}
+
+
+void PointsToFileWriter::writeBytes(const void *bytes, size_t size)
+{
+    if (std::fwrite(bytes, 1, size, file) != size)
+        failed = true;
+}
+
+
+void PointsToFileWriter::writeVarint(uint64_t value)
+{
+    uint8_t bytes[10];
+    size_t size = 0;
+    for (; value >= 0x80; value >>= 7)
+        bytes[size++] = (uint8_t) (value | 0x80);
+    bytes[size++] = (uint8_t) value;
+    writeBytes(bytes, size);
+    dataSize += size;
+}
+
+
+void PointsToFileWriter::skipTo(unsigned src)
+{
+    for (; nextNode < src; ++nextNode)
+    {
+        offsets.push_back(dataSize);
+        writeVarint(0);
+    }
+}
+
+
+PointsToFileReader::PointsToFileReader(const std::string &fname)
+{
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t) st.st_size < PointsToFile::HeaderSizeV1)
+    {
+        ::close(fd);
+        return;
+    }
+    void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return;
+    base = static_cast<const uint8_t *>(addr);
+    fileSize = st.st_size;
+
+    // Check the header and that the index and the data fit in the file
+    uint32_t version = loadLittle<uint32_t>(base + 8);
+    size_t headerSize = version == 1 ? PointsToFile::HeaderSizeV1 : PointsToFile::HeaderSize;
+    nodeNum = loadLittle<uint32_t>(base + 12);
+    edgeNum = loadLittle<uint64_t>(base + 16);
+    flags = version == 1 || fileSize < headerSize ? 0 : loadLittle<uint32_t>(base + 24);
+    index = base + headerSize;
+    data = index + 8 * ((size_t) nodeNum + 1);
+    bool valid = std::memcmp(base, PointsToFile::Magic, 8) == 0 &&
+                 (version == 1 || version == PointsToFile::Version) &&
+                 (size_t) (data - base) <= fileSize &&
+                 loadLittle<uint64_t>(index + 8 * (size_t) nodeNum) <= fileSize - (data - base);
+    if (!valid)
+    {
+        ::munmap(const_cast<uint8_t *>(base), fileSize);
+        base = nullptr;
+        nodeNum = 0;
+        edgeNum = 0;
+        flags = 0;
+    }
+}
+
+
+PointsToFileReader::~PointsToFileReader()
+{
+    if (base)
+        ::munmap(const_cast<uint8_t *>(base), fileSize);
+}
+
+
+size_t PointsToFileReader::getPointsToNum(unsigned src) const
+{
+    size_t num = 0;
+    for (Cursor cursor = getCursor(src); !cursor.atEnd(); cursor.next())
+        ++num;
+    return num;
+}
+
+
+void PointsToFileReader::getPointsTo(unsigned src, std::vector<unsigned> &out) const
+{
+    for (Cursor cursor = getCursor(src); !cursor.atEnd(); cursor.next())
+        out.push_back(cursor.get());
+}
+
+
+bool PointsToFileReader::pointsTo(unsigned src, unsigned dst) const
+{
+    for (Cursor cursor = getCursor(src); !cursor.atEnd() && cursor.get() <= dst; cursor.next())
+    {
+        if (cursor.get() == dst)
+            return true;
+    }
+    return false;
+}
+
+
+bool PointsToFileReader::mayAlias(unsigned a, unsigned b) const
+{
+    Cursor lhs = getCursor(a), rhs = getCursor(b);
+    while (!lhs.atEnd() && !rhs.atEnd())
+    {
+        if (lhs.get() == rhs.get())
+            return true;
+        if (lhs.get() < rhs.get())
+            lhs.next();
+        else
+            rhs.next();
+    }
+    return false;
+}
+
+
+PointsToFileReader::Cursor PointsToFileReader::getCursor(unsigned src) const
+{
+    if (!base || src >= nodeNum)
+        return Cursor(nullptr, nullptr);
+    uint64_t begin = loadLittle<uint64_t>(index + 8 * (size_t) src);
+    uint64_t end = loadLittle<uint64_t>(index + 8 * ((size_t) src + 1));
+    if (begin > end || end > fileSize - (data - base))
+        return Cursor(nullptr, nullptr);
+    return Cursor(data + begin, data + end);
+}
+
+
+PointsToFileReader::Cursor::Cursor(const uint8_t *pos, const uint8_t *end) :
+        pos(pos), end(end), left(0)
+{
+    uint64_t count, first;
+    if (pos == end || !readVarint(count) || !count || !readVarint(first))
+        return;
+    left = count;
+    value = first;
+}
+
+
+void PointsToFileReader::Cursor::next()
+{
+    uint64_t delta;
+    if (--left && !readVarint(delta))
+        left = 0;
+    else if (left)
+        value += delta;
+}
+
+
+bool PointsToFileReader::Cursor::readVarint(uint64_t &value)
+{
+    value = 0;
+    for (unsigned shift = 0; pos < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *pos++;
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    // a set cut short ends here
+    return false;
+}
@@ -0,0 +1,168 @@
+/**
+ * PointsToFile.h
+ *
+ * A binary file of points-to sets, for tools that look up a few pointers without parsing
+ * the text results. All integers are little-endian.
+ *
+ *   header   magic "CFLRPTS\0", u32 version, u32 nodeNum, u64 edgeNum, u32 flags, u32 reserved
+ *            (version 1 files end the header before flags)
+ *   index    u64 offsets[nodeNum + 1], where the set of node n spans [offsets[n], offsets[n + 1])
+ *            relative to the start of the data
+ *   data     per node: varint count, then the targets in ascending order as varints, the first
+ *            one as is and every other one as the difference from its predecessor
+ *
+ * Varints are LEB128: seven bits per byte, low bits first, the high bit set on all but the last.
+ * This header has no dependency on SVF, so the reader can be linked on its own (ptsfile).
+ */
+
+#ifndef ANSWERS_POINTSTOFILE_H
+#define ANSWERS_POINTSTOFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace PointsToFile
+{
+constexpr char Magic[8] = {'C', 'F', 'L', 'R', 'P', 'T', 'S', '\0'};
+constexpr uint32_t Version = 2;
+constexpr size_t HeaderSize = 8 + 4 + 4 + 8 + 4 + 4;
+constexpr size_t HeaderSizeV1 = 8 + 4 + 4 + 8;
+
+/// The sets are subsets of the result, solving stopped before the fixed point
+constexpr uint32_t Incomplete = 1;
+}
+
+
+/**
+ * Writes a points-to file. The sets are streamed out as they come; the index is kept in
+ * memory and written in front of them when the file is closed.
+ */
+class PointsToFileWriter
+{
+public:
+    /// Create or truncate a file for the sets of the nodes [0, nodeNum)
+    PointsToFileWriter(const std::string &fname, unsigned nodeNum, uint32_t flags = 0);
+
+    /// Close the file if close() was not called
+    ~PointsToFileWriter();
+
+    PointsToFileWriter(const PointsToFileWriter &) = delete;
+    PointsToFileWriter &operator=(const PointsToFileWriter &) = delete;
+
+    bool isOpen() const
+    { return file != nullptr; }
+
+    /**
+     * Write the points-to set of src. Sources must come in ascending order; the ones skipped
+     * get empty sets.
+     * @param dsts the targets in ascending order
+     */
+    void writePointsTo(unsigned src, const std::vector<unsigned> &dsts);
+
+    /**
+     * Write the index and close the file
+     * @return false if a write failed
+     */
+    bool close();
+
+private:
+    void writeBytes(const void *data, size_t size);
+    void writeVarint(uint64_t value);
+    /// Record empty sets for the nodes before src
+    void skipTo(unsigned src);
+
+    std::FILE *file = nullptr;
+    bool failed = false;
+    unsigned nodeNum;
+    uint32_t flags;
+    unsigned nextNode = 0;
+    uint64_t edgeNum = 0;
+    uint64_t dataSize = 0;
+    std::vector<uint64_t> offsets;
+};
+
+
+/**
+ * Reads a points-to file through a read-only memory mapping: only the pages of the sets
+ * that are looked up are ever loaded.
+ */
+class PointsToFileReader
+{
+public:
+    /// Map a file; check with isOpen()
+    explicit PointsToFileReader(const std::string &fname);
+
+    ~PointsToFileReader();
+
+    PointsToFileReader(const PointsToFileReader &) = delete;
+    PointsToFileReader &operator=(const PointsToFileReader &) = delete;
+
+    /// Whether the file was mapped and has a valid header and index
+    bool isOpen() const
+    { return base != nullptr; }
+
+    unsigned getNodeNum() const
+    { return nodeNum; }
+
+    uint64_t getEdgeNum() const
+    { return edgeNum; }
+
+    uint32_t getFlags() const
+    { return flags; }
+
+    /// Whether the sets are the whole result, not the part found before solving stopped
+    bool isComplete() const
+    { return !(flags & PointsToFile::Incomplete); }
+
+    /// Number of targets of src
+    size_t getPointsToNum(unsigned src) const;
+
+    /// Append the targets of src to out in ascending order
+    void getPointsTo(unsigned src, std::vector<unsigned> &out) const;
+
+    /// Check whether src points to dst
+    bool pointsTo(unsigned src, unsigned dst) const;
+
+    /// Check whether the points-to sets of two nodes intersect
+    bool mayAlias(unsigned a, unsigned b) const;
+
+private:
+    /// Walks the targets of one set
+    class Cursor
+    {
+    public:
+        Cursor(const uint8_t *pos, const uint8_t *end);
+
+        bool atEnd() const
+        { return left == 0; }
+
+        unsigned get() const
+        { return value; }
+
+        void next();
+
+    private:
+        /// @return false if the set ends in the middle of a varint
+        bool readVarint(uint64_t &value);
+
+        const uint8_t *pos;
+        const uint8_t *end;
+        size_t left;
+        unsigned value = 0;
+    };
+
+    Cursor getCursor(unsigned src) const;
+
+    const uint8_t *base = nullptr;
+    size_t fileSize = 0;
+    unsigned nodeNum = 0;
+    uint64_t edgeNum = 0;
+    uint32_t flags = 0;
+    const uint8_t *index = nullptr;
+    const uint8_t *data = nullptr;
+};
+
+#endif //ANSWERS_POINTSTOFILE_H
@@ -0,0 +1,159 @@
+/**
+ * ResultWriter.cpp
+ */
+
+#include "ResultWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr size_t BufferSize = 1 << 22;
+constexpr char Separator[] = "\tpoints to\t";
+constexpr size_t SeparatorSize = sizeof(Separator) - 1;
+
+inline size_t digitNum(unsigned value)
+{
+    size_t num = 1;
+    for (; value >= 10; value /= 10)
+        ++num;
+    return num;
+}
+}
+
+
+ResultWriter::ResultWriter(const std::string &fname, size_t mappedSize)
+{
+    fd = ::open(fname.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+
+    if (mappedSize)
+    {
+        void *addr = MAP_FAILED;
+        if (::ftruncate(fd, mappedSize) == 0)
+            addr = ::mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            ::close(fd);
+            fd = -1;
+            return;
+        }
+        mapping = static_cast<char *>(addr);
+        this->mappedSize = mappedSize;
+        begin = cur = mapping;
+        end = mapping + mappedSize;
+        return;
+    }
+
+    buffer.resize(BufferSize);
+    begin = cur = buffer.data();
+    end = buffer.data() + buffer.size();
+}
+
+
+ResultWriter::~ResultWriter()
+{
+    close();
+}
+
+
+void ResultWriter::writePointsTo(unsigned src, const std::vector<unsigned> &dsts)
+{
+    if (fd < 0 || dsts.empty())
+        return;
+
+    char head[10 + SeparatorSize];
+    char *headEnd = std::to_chars(head, head + 10, src).ptr;
+    std::memcpy(headEnd, Separator, SeparatorSize);
+    size_t headSize = headEnd + SeparatorSize - head;
+
+    for (unsigned dst : dsts)
+    {
+        reserve(headSize + digitNum(dst) + 1);
+        if (failed)
+            return;
+        std::memcpy(cur, head, headSize);
+        cur = std::to_chars(cur + headSize, end, dst).ptr;
+        *cur++ = '\n';
+    }
+}
+
+
+bool ResultWriter::close()
+{
+    if (fd < 0)
+        return !failed;
+
+    if (mapping)
+    {
+        ::munmap(mapping, mappedSize);
+        // the size given up front was not used up, cut off the rest
+        if ((size_t) (cur - mapping) != mappedSize && ::ftruncate(fd, cur - mapping) != 0)
+            failed = true;
+        mapping = nullptr;
+    }
+    else
+        flush();
+
+    failed |= ::close(fd) != 0;
+    fd = -1;
+    return !failed;
+}
+
+
+void ResultWriter::writeComment(const std::string &text)
+{
+    if (fd < 0)
+        return;
+    reserve(getCommentSize(text));
+    if (failed)
+        return;
+    *cur++ = '#';
+    *cur++ = ' ';
+    cur = std::copy(text.begin(), text.end(), cur);
+    *cur++ = '\n';
+}
+
+
+size_t ResultWriter::getTextSize(unsigned src, const std::vector<unsigned> &dsts)
+{
+    size_t size = dsts.size() * (digitNum(src) + SeparatorSize + 1);
+    for (unsigned dst : dsts)
+        size += digitNum(dst);
+    return size;
+}
+
+
+void ResultWriter::reserve(size_t n)
+{
+    if ((size_t) (end - cur) >= n)
+        return;
+    if (mapping)
+    {
+        // lines beyond the size given up front are dropped
+        failed = true;
+        return;
+    }
+    flush();
+}
+
+
+void ResultWriter::flush()
+{
+    while (begin < cur && !failed)
+    {
+        ssize_t written = ::write(fd, begin, cur - begin);
+        if (written < 0 && errno != EINTR)
+            failed = true;
+        else if (written > 0)
+            begin += written;
+    }
+    begin = cur = buffer.data();
+}
@@ -0,0 +1,72 @@
+/**
+ * ResultWriter.h
+ */
+
+#ifndef ANSWERS_RESULTWRITER_H
+#define ANSWERS_RESULTWRITER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * Writes points-to results as "src\tpoints to\tdst" lines.
+ *
+ * Lines are formatted straight into a large buffer that is written out whenever it fills,
+ * with no flush per line. When the exact size of the output is known up front (see
+ * getTextSize), the file can be mapped instead and the lines are formatted into the mapping.
+ */
+class ResultWriter
+{
+public:
+    /**
+     * Create or truncate a result file
+     * @param mappedSize the exact size of the output to map the file with, 0 to write through a buffer
+     */
+    explicit ResultWriter(const std::string &fname, size_t mappedSize = 0);
+
+    /// Flush and close the file
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter &) = delete;
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    /// Whether the file could be opened (and mapped)
+    bool isOpen() const
+    { return fd >= 0; }
+
+    /// Write one line per target of src, in the order given
+    void writePointsTo(unsigned src, const std::vector<unsigned> &dsts);
+
+    /// Write "# text" as a line of its own; text must not hold a newline
+    void writeComment(const std::string &text);
+
+    /**
+     * Flush what is left and close the file
+     * @return false if a write failed
+     */
+    bool close();
+
+    /// Number of bytes writePointsTo produces for src and dsts
+    static size_t getTextSize(unsigned src, const std::vector<unsigned> &dsts);
+
+    /// Number of bytes writeComment produces for text
+    static size_t getCommentSize(const std::string &text)
+    { return text.size() + 3; }
+
+private:
+    /// Make room for n more bytes
+    void reserve(size_t n);
+    void flush();
+
+    int fd = -1;
+    bool failed = false;
+    char *mapping = nullptr;    // the mapped file, or nullptr when writing through buffer
+    size_t mappedSize = 0;
+    std::vector<char> buffer;
+    char *begin = nullptr;      // start of the unwritten part of the buffer
+    char *cur = nullptr;        // where the next byte goes
+    char *end = nullptr;        // end of the buffer or the mapping
+};
+
+#endif //ANSWERS_RESULTWRITER_H
@@ -0,0 +1,143 @@
+/**
+ * RuleKernels.h
+ *
+ * Join kernels for a grammar that is known at compile time. Each rule is a type carrying its
+ * labels as template arguments; GrammarKernels folds the rules into one function per operand
+ * label, so popping an edge costs a single indirect call and no label tests at run time.
+ */
+
+#ifndef ANSWERS_RULEKERNELS_H
+#define ANSWERS_RULEKERNELS_H
+
+#include "A4Header.h"
+
+#include <array>
+
+/// A ::= B
+template<EdgeLabel A, EdgeLabel B>
+struct UnaryRuleKernel
+{
+    template<EdgeLabel L>
+    static inline void apply(CFLR &solver, unsigned x, unsigned z)
+    {
+        if constexpr (L == B)
+            solver.applyUnaryRule(x, z, B, A);
+    }
+
+    static void addTo(CFLGrammar &g)
+    { g.addUnaryRule(A, B); }
+};
+
+
+/// A ::= B C
+template<EdgeLabel A, EdgeLabel B, EdgeLabel C>
+struct BinaryRuleKernel
+{
+    template<EdgeLabel L>
+    static inline void apply(CFLR &solver, unsigned x, unsigned z)
+    {
+        if constexpr (L == B)
+            solver.joinSuccessors(x, z, C, A);
+        if constexpr (L == C)
+            solver.joinPredecessors(x, z, B, A);
+    }
+
+    static void addTo(CFLGrammar &g)
+    { g.addBinaryRule(A, B, C); }
+};
+
+
+/// A ::= epsilon; folded into the unary rules by normalization, nothing to join
+template<EdgeLabel A>
+struct EpsilonRuleKernel
+{
+    template<EdgeLabel L>
+    static inline void apply(CFLR &, unsigned, unsigned)
+    {}
+
+    static void addTo(CFLGrammar &g)
+    { g.addEpsilonRule(A); }
+};
+
+
+/**
+ * The kernels of a grammar over the labels [0, LabelNum)
+ */
+template<EdgeLabel LabelNum, class... Rules>
+struct GrammarKernels
+{
+    using Kernel = void (*)(CFLR &, unsigned, unsigned);
+
+    /// Apply every rule that has label L as an operand
+    template<EdgeLabel L>
+    static void dispatch(CFLR &solver, unsigned x, unsigned z)
+    { (Rules::template apply<L>(solver, x, z), ...); }
+
+    /// Join a new edge through the kernel of its label
+    static inline void apply(CFLR &solver, const CFLREdge &edge)
+    {
+        assert(edge.label < LabelNum && "label is not in the compiled grammar");
+        table[edge.label](solver, edge.src, edge.dst);
+    }
+
+    /// The compiled rules as a grammar, to compare with the one in use
+    static const CFLGrammar &grammar()
+    {
+        static const CFLGrammar g = [] {
+            CFLGrammar rules;
+            (Rules::addTo(rules), ...);
+            return rules;
+        }();
+        return g;
+    }
+
+private:
+    template<size_t... Ls>
+    static constexpr std::array<Kernel, LabelNum> makeTable(std::index_sequence<Ls...>)
+    { return {&dispatch<Ls>...}; }
+
+    static constexpr std::array<Kernel, LabelNum> table = makeTable(std::make_index_sequence<LabelNum>());
+};
+
+
+/// CFLGrammar::pointsTo() in binary normal form
+using PointsToKernels = GrammarKernels<LVBar + 1,
+        BinaryRuleKernel<PT, VFBar, AddrBar>,
+        BinaryRuleKernel<PTBar, Addr, VF>,
+        BinaryRuleKernel<VF, VF, VF>,
+        UnaryRuleKernel<VF, Copy>,
+        BinaryRuleKernel<VF, SV, Load>,
+        BinaryRuleKernel<VF, PV, Load>,
+        BinaryRuleKernel<VF, Store, VP>,
+        BinaryRuleKernel<VFBar, VFBar, VFBar>,
+        UnaryRuleKernel<VFBar, CopyBar>,
+        BinaryRuleKernel<VFBar, LoadBar, SVBar>,
+        BinaryRuleKernel<VFBar, LoadBar, VP>,
+        BinaryRuleKernel<VFBar, PV, StoreBar>,
+        BinaryRuleKernel<VA, LV, Load>,
+        BinaryRuleKernel<VA, VFBar, VA>,
+        BinaryRuleKernel<VA, VA, VF>,
+        BinaryRuleKernel<SV, Store, VA>,
+        BinaryRuleKernel<SVBar, VA, StoreBar>,
+        BinaryRuleKernel<PV, PTBar, VA>,
+        BinaryRuleKernel<VP, VA, PT>,
+        BinaryRuleKernel<LV, LoadBar, VA>,
+        // unary rules left by the nullable VF, VFBar and VA, and their closure
+        UnaryRuleKernel<PT, AddrBar>,
+        UnaryRuleKernel<PTBar, Addr>,
+        UnaryRuleKernel<VA, VFBar>,
+        UnaryRuleKernel<VA, VF>,
+        UnaryRuleKernel<VA, Copy>,
+        UnaryRuleKernel<VA, CopyBar>,
+        UnaryRuleKernel<SV, Store>,
+        UnaryRuleKernel<SVBar, StoreBar>,
+        UnaryRuleKernel<PV, PTBar>,
+        UnaryRuleKernel<PV, Addr>,
+        UnaryRuleKernel<VP, PT>,
+        UnaryRuleKernel<VP, AddrBar>,
+        UnaryRuleKernel<LV, LoadBar>,
+        EpsilonRuleKernel<VF>,
+        EpsilonRuleKernel<VFBar>,
+        EpsilonRuleKernel<VA>>;
+
+#endif //ANSWERS_RULEKERNELS_H
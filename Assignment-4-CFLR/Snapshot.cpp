@@ -0,0 +1,234 @@
+/**
+ * Snapshot.cpp
+ *
+ * Saving and loading the state of the solver. A snapshot file holds, in native byte order:
+ *
+ *   header   magic "CFLRSNAP", u32 version, u32 complete, u64 input key,
+ *            u32 labelNum, u32 mergedNum, u64 pendingNum
+ *   counts   u64 edgeNum[labelNum]
+ *   edges    per label: u32 srcs[edgeNum], then u32 dsts[edgeNum]
+ *   merged   u32 (node, representative) pairs of the nodes merged by cycle collapsing
+ *   pending  u32 (src, dst, label) triples of the edges not joined yet
+ */
+
+#include "A4Header.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr char SnapshotMagic[8] = {'C', 'F', 'L', 'R', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SnapshotVersion = 1;
+constexpr size_t SnapshotBufferSize = 1 << 20;
+
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t complete;
+    uint64_t key;
+    uint32_t labelNum;
+    uint32_t mergedNum;
+    uint64_t pendingNum;
+};
+
+inline void hashWord(uint64_t &hash, uint64_t word)
+{
+    for (int i = 0; i < 8; ++i, word >>= 8)
+    {
+        hash ^= word & 0xff;
+        hash *= 0x100000001b3ULL;
+    }
+}
+}
+
+
+uint64_t CFLR::hashInput() const
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hashWord(hash, grammar.getLabelNum());
+    for (EdgeLabel head = 0; head < grammar.getLabelNum(); ++head)
+    {
+        for (EdgeLabel body : grammar.getUnaryBodies(head))
+            hashWord(hash, ((uint64_t) head << 32) | body);
+        for (const auto &rule : grammar.getHeadRules(head))
+            hashWord(hash, ((uint64_t) rule.left << 32) | rule.right);
+        hashWord(hash, ~(uint64_t) 0);
+    }
+    graph->forEachEdge([&](unsigned src, unsigned dst, EdgeLabel label) {
+        hashWord(hash, label);
+        hashWord(hash, ((uint64_t) src << 32) | dst);
+    });
+    return hash;
+}
+
+
+bool CFLR::useSnapshot(const std::string &fname, unsigned checkpointSeconds)
+{
+    snapshotFile = fname;
+    checkpointInterval = checkpointSeconds;
+    lastCheckpoint = std::chrono::steady_clock::now();
+    inputKey = hashInput();
+    return loadSnapshot();
+}
+
+
+bool CFLR::checkpointDue()
+{
+    if (!checkpointInterval || snapshotFile.empty())
+        return false;
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastCheckpoint < std::chrono::seconds(checkpointInterval))
+        return false;
+    lastCheckpoint = now;
+    return true;
+}
+
+
+void CFLR::saveSnapshot(const std::vector<CFLREdge> &pending, bool complete)
+{
+    std::string tmpName = snapshotFile + ".tmp";
+    std::FILE *file = std::fopen(tmpName.c_str(), "wb");
+    if (!file)
+    {
+        std::cout << "error opening " + tmpName + "!!\n";
+        return;
+    }
+    std::setvbuf(file, nullptr, _IOFBF, SnapshotBufferSize);
+    bool failed = false;
+    auto write = [&](const void *data, size_t size) {
+        if (size && std::fwrite(data, 1, size, file) != size)
+            failed = true;
+    };
+
+    std::vector<std::pair<unsigned, unsigned>> merged;
+    for (unsigned node = 0; node < nodeReps.getNodeNum(); ++node)
+    {
+        unsigned rep = nodeReps.find(node);
+        if (rep != node)
+            merged.emplace_back(node, rep);
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version = SnapshotVersion;
+    header.complete = complete;
+    header.key = inputKey;
+    header.labelNum = grammar.getLabelNum();
+    header.mergedNum = merged.size();
+    header.pendingNum = pending.size();
+    write(&header, sizeof(header));
+
+    // A mirrored label is saved with its stored label, as no edges of its own
+    std::vector<uint64_t> edgeNums(header.labelNum);
+    for (EdgeLabel label = 0; label < header.labelNum; ++label)
+        edgeNums[label] = graph->getStoredLabel(label) == label ? graph->getEdgeNum(label) : 0;
+    write(edgeNums.data(), edgeNums.size() * sizeof(uint64_t));
+
+    std::vector<unsigned> srcs, dsts;
+    for (EdgeLabel label = 0; label < header.labelNum; ++label)
+    {
+        srcs.clear();
+        dsts.clear();
+        if (graph->getStoredLabel(label) != label)
+            continue;
+        graph->forEachEdge(label, [&](unsigned src, unsigned dst) {
+            srcs.push_back(src);
+            dsts.push_back(dst);
+        });
+        write(srcs.data(), srcs.size() * sizeof(unsigned));
+        write(dsts.data(), dsts.size() * sizeof(unsigned));
+    }
+    for (const auto &pair : merged)
+    {
+        unsigned words[2] = {pair.first, pair.second};
+        write(words, sizeof(words));
+    }
+    for (const CFLREdge &edge : pending)
+    {
+        unsigned words[3] = {edge.src, edge.dst, edge.label};
+        write(words, sizeof(words));
+    }
+
+    failed |= std::fclose(file) != 0;
+    if (failed || std::rename(tmpName.c_str(), snapshotFile.c_str()) != 0)
+    {
+        std::cout << "error writing " + snapshotFile + "!!\n";
+        std::remove(tmpName.c_str());
+    }
+}
+
+
+bool CFLR::loadSnapshot()
+{
+    int fd = ::open(snapshotFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    size_t fileSize = st.st_size;
+    void *addr = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    const char *base = static_cast<const char *>(addr);
+
+    // Check the header and that every section fits before touching the graph
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    bool valid = std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) == 0 &&
+                 header.version == SnapshotVersion && header.key == inputKey &&
+                 header.labelNum == grammar.getLabelNum();
+    size_t offset = sizeof(header);
+    std::vector<uint64_t> edgeNums;
+    if (valid && fileSize - offset >= (size_t) header.labelNum * sizeof(uint64_t))
+    {
+        edgeNums.resize(header.labelNum);
+        std::memcpy(edgeNums.data(), base + offset, edgeNums.size() * sizeof(uint64_t));
+        offset += edgeNums.size() * sizeof(uint64_t);
+        uint64_t words = 2 * (uint64_t) header.mergedNum + 3 * header.pendingNum;
+        for (uint64_t edgeNum : edgeNums)
+            words += 2 * edgeNum;
+        valid = words == (fileSize - offset) / sizeof(unsigned) && (fileSize - offset) % sizeof(unsigned) == 0;
+    }
+    else
+        valid = false;
+    if (!valid)
+    {
+        ::munmap(addr, fileSize);
+        return false;
+    }
+
+    const unsigned *words = reinterpret_cast<const unsigned *>(base + offset);
+    for (EdgeLabel label = 0; label < header.labelNum; ++label)
+    {
+        std::vector<unsigned> srcs(words, words + edgeNums[label]);
+        words += edgeNums[label];
+        std::vector<unsigned> dsts(words, words + edgeNums[label]);
+        words += edgeNums[label];
+        if (graph->getStoredLabel(label) == label)
+            graph->assignEdges(label, srcs, dsts);
+    }
+    for (uint32_t i = 0; i < header.mergedNum; ++i, words += 2)
+        nodeReps.attach(words[0], words[1]);
+    pendingEdges.clear();
+    for (uint64_t i = 0; i < header.pendingNum; ++i, words += 3)
+    {
+        if (words[2] < header.labelNum)
+            pendingEdges.emplace_back(words[0], words[1], words[2]);
+    }
+    ::munmap(addr, fileSize);
+
+    solved = header.complete;
+    resuming = !solved;
+    return true;
+}
@@ -0,0 +1,199 @@
+/**
+ * SolverStats.cpp
+ */
+
+#include "SolverStats.h"
+#include "A4Header.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <tuple>
+
+namespace
+{
+/// A name as a JSON string; grammar files may give labels any characters but whitespace
+std::string jsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            quoted += {'\\', c};
+        else if ((unsigned char) c < 0x20)
+        {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char) c);
+            quoted += escape;
+        }
+        else
+            quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/// A name as a CSV field, with its quotes doubled
+std::string csvField(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+}
+
+
+void SolverStats::countJoin(unsigned head, unsigned left, unsigned right, uint64_t probes, uint64_t derived)
+{
+    uint64_t key = ((uint64_t) head << 42) ^ ((uint64_t) left << 21) ^ (uint64_t) right;
+    auto it = rules.find(key);
+    if (it == rules.end())
+    {
+        RuleCounters counters;
+        counters.head = head;
+        counters.left = left;
+        counters.right = right;
+        it = rules.emplace(key, counters).first;
+    }
+    ++it->second.joins;
+    it->second.probes += probes;
+    it->second.derived += derived;
+}
+
+
+void SolverStats::sample(size_t worklistSize)
+{
+    if (sampleInterval == 0)
+        return;
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (ms - lastSample < sampleInterval)
+        return;
+    lastSample = ms;
+    samples.push_back({ms, popped, derived, worklistSize});
+}
+
+
+uint64_t SolverStats::getDuplicates() const
+{
+    uint64_t num = 0;
+    for (const LabelCounters &label : labels)
+        num += label.duplicates;
+    return num;
+}
+
+
+uint64_t SolverStats::getProbes() const
+{
+    uint64_t num = 0;
+    for (const auto &rule : rules)
+        num += rule.second.probes;
+    return num;
+}
+
+
+void SolverStats::addPhaseTime(const char *phase, double ms)
+{
+    for (auto &entry : phases)
+    {
+        if (entry.first == phase)
+        {
+            entry.second += ms;
+            return;
+        }
+    }
+    phases.emplace_back(phase, ms);
+}
+
+
+bool SolverStats::write(const std::string &fname, const std::string &format, const CFLGrammar &grammar,
+                        const CFLRGraph *graph) const
+{
+    std::ofstream outFile(fname);
+    if (!outFile)
+    {
+        std::cout << "error opening " + fname + "!!\n";
+        return false;
+    }
+
+    // The costliest rules first
+    std::vector<const RuleCounters *> ruleList;
+    for (const auto &entry : rules)
+        ruleList.push_back(&entry.second);
+    std::sort(ruleList.begin(), ruleList.end(), [](const RuleCounters *a, const RuleCounters *b) {
+        if (a->probes != b->probes)
+            return a->probes > b->probes;
+        return std::tie(a->head, a->left, a->right) < std::tie(b->head, b->left, b->right);
+    });
+    auto ruleName = [&](const RuleCounters &rule) {
+        std::string name = grammar.getLabelName(rule.head) + " ::= " + grammar.getLabelName(rule.left);
+        if (rule.right != NoRight)
+            name += " " + grammar.getLabelName(rule.right);
+        return name;
+    };
+    auto edgeNum = [&](EdgeLabel label) { return graph ? graph->getEdgeNum(label) : 0; };
+    LabelCounters none;
+    auto counters = [&](EdgeLabel label) -> const LabelCounters & {
+        return label < labels.size() ? labels[label] : none;
+    };
+
+    if (format == "csv")
+    {
+        outFile << "section,name,metric,value\n";
+        for (const auto &phase : phases)
+            outFile << "phase," << csvField(phase.first) << ",ms," << phase.second << "\n";
+        outFile << "solver,,popped," << popped << "\n"
+                << "solver,,derived," << derived << "\n"
+                << "solver,,peakWorklist," << peakWorklist << "\n";
+        for (EdgeLabel label = 0; label < grammar.getLabelNum(); ++label)
+        {
+            std::string name = csvField(grammar.getLabelName(label));
+            outFile << "label," << name << ",pushes," << counters(label).pushes << "\n"
+                    << "label," << name << ",pops," << counters(label).pops << "\n"
+                    << "label," << name << ",duplicates," << counters(label).duplicates << "\n"
+                    << "label," << name << ",edges," << edgeNum(label) << "\n";
+        }
+        for (const RuleCounters *rule : ruleList)
+        {
+            std::string name = csvField(ruleName(*rule));
+            outFile << "rule," << name << ",joins," << rule->joins << "\n"
+                    << "rule," << name << ",probes," << rule->probes << "\n"
+                    << "rule," << name << ",derived," << rule->derived << "\n";
+        }
+        for (const Sample &s : samples)
+        {
+            outFile << "sample," << s.ms << ",popped," << s.popped << "\n"
+                    << "sample," << s.ms << ",derived," << s.derived << "\n"
+                    << "sample," << s.ms << ",worklist," << s.worklist << "\n";
+        }
+    }
+    else
+    {
+        outFile << "{\n  \"phases\": {";
+        for (size_t i = 0; i < phases.size(); ++i)
+            outFile << (i ? ", " : "") << jsonString(phases[i].first) << ": " << phases[i].second;
+        outFile << "},\n  \"popped\": " << popped << ",\n  \"derived\": " << derived
+                << ",\n  \"peakWorklist\": " << peakWorklist << ",\n  \"labels\": [";
+        for (EdgeLabel label = 0; label < grammar.getLabelNum(); ++label)
+        {
+            outFile << (label ? "," : "") << "\n    {\"label\": " << jsonString(grammar.getLabelName(label))
+                    << ", \"pushes\": " << counters(label).pushes << ", \"pops\": " << counters(label).pops
+                    << ", \"duplicates\": " << counters(label).duplicates << ", \"edges\": " << edgeNum(label)
+                    << "}";
+        }
+        outFile << "\n  ],\n  \"rules\": [";
+        for (size_t i = 0; i < ruleList.size(); ++i)
+        {
+            outFile << (i ? "," : "") << "\n    {\"rule\": " << jsonString(ruleName(*ruleList[i]))
+                    << ", \"joins\": " << ruleList[i]->joins << ", \"probes\": " << ruleList[i]->probes
+                    << ", \"derived\": " << ruleList[i]->derived << "}";
+        }
+        outFile << "\n  ],\n  \"samples\": [";
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            outFile << (i ? "," : "") << "\n    {\"ms\": " << samples[i].ms << ", \"popped\": " << samples[i].popped
+                    << ", \"derived\": " << samples[i].derived << ", \"worklist\": " << samples[i].worklist << "}";
+        }
+        outFile << "\n  ]\n}\n";
+    }
+    return (bool) outFile;
+}
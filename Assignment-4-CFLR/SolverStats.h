@@ -0,0 +1,167 @@
+/**
+ * SolverStats.h
+ *
+ * Counters and timers of the worklist solver, to find the labels and rules a slow run spends
+ * its time on: pushes and pops per label, duplicate edges turned away, the peak length of the
+ * worklist, and for every rule how often it was joined, how many neighbours the joins probed
+ * and how many new edges they derived. Phases are timed, and the progress can be sampled at
+ * an interval; everything is written as JSON or CSV once the run is over.
+ *
+ * The statistics exist only when CFLR_STATS is defined, which the build does for Debug or
+ * with -DCFLR_STATS=ON. Otherwise every CFLR_STAT(...) expands to nothing, so the solver
+ * carries no trace of them.
+ */
+
+#ifndef ANSWERS_SOLVERSTATS_H
+#define ANSWERS_SOLVERSTATS_H
+
+#ifdef CFLR_STATS
+#define CFLR_STAT(...) __VA_ARGS__
+#else
+#define CFLR_STAT(...)
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CFLGrammar;
+class CFLRGraph;
+
+class SolverStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// Adds the time from its construction to its destruction to a phase
+    class PhaseTimer
+    {
+    public:
+        PhaseTimer(SolverStats &stats, const char *phase) : stats(stats), phase(phase), start(Clock::now())
+        {}
+
+        ~PhaseTimer()
+        { stats.addPhaseTime(phase, std::chrono::duration<double, std::milli>(Clock::now() - start).count()); }
+
+    private:
+        SolverStats &stats;
+        const char *phase;
+        Clock::time_point start;
+    };
+
+    SolverStats() : start(Clock::now())
+    {}
+
+    /// Time the enclosing scope as a phase: auto timer = stats.time("propagate");
+    PhaseTimer time(const char *phase)
+    { return PhaseTimer(*this, phase); }
+
+    /// Record a progress sample every interval milliseconds, 0 for none
+    void setSampleInterval(unsigned ms)
+    { sampleInterval = ms; }
+
+    inline void countPush(unsigned label, size_t worklistSize)
+    {
+        ++at(label).pushes;
+        if (worklistSize > peakWorklist)
+            peakWorklist = worklistSize;
+    }
+
+    /// A popped edge is the operand whose rules are joined next
+    inline void countPop(unsigned label)
+    {
+        ++at(label).pops;
+        ++popped;
+        operand = label;
+    }
+
+    inline void countDuplicate(unsigned label)
+    { ++at(label).duplicates; }
+
+    inline void countDerived()
+    { ++derived; }
+
+    uint64_t getDerived() const
+    { return derived; }
+
+    uint64_t getPopped() const
+    { return popped; }
+
+    /// Edges derived again and turned away, over all labels
+    uint64_t getDuplicates() const;
+
+    /// Neighbours probed by the joins, over all rules
+    uint64_t getProbes() const;
+
+    unsigned getOperand() const
+    { return operand; }
+
+    /**
+     * Count one join of the rule head ::= left right (right is NoRight for head ::= left)
+     * @param probes the neighbours visited
+     * @param derived the edges it added to the graph
+     */
+    void countJoin(unsigned head, unsigned left, unsigned right, uint64_t probes, uint64_t derived);
+
+    static constexpr unsigned NoRight = ~0u;
+
+    /// Record a sample if the interval has passed since the last one
+    void sample(size_t worklistSize);
+
+    void addPhaseTime(const char *phase, double ms);
+
+    /**
+     * Write the statistics, with the final number of edges of every label in graph
+     * @param format "json" or "csv"
+     * @return false if the file cannot be written
+     */
+    bool write(const std::string &fname, const std::string &format, const CFLGrammar &grammar,
+               const CFLRGraph *graph) const;
+
+private:
+    struct LabelCounters
+    {
+        uint64_t pushes = 0;
+        uint64_t pops = 0;
+        uint64_t duplicates = 0;
+    };
+
+    struct RuleCounters
+    {
+        unsigned head, left, right;
+        uint64_t joins = 0;
+        uint64_t probes = 0;
+        uint64_t derived = 0;
+    };
+
+    struct Sample
+    {
+        double ms;
+        uint64_t popped;
+        uint64_t derived;
+        size_t worklist;
+    };
+
+    inline LabelCounters &at(unsigned label)
+    {
+        if (label >= labels.size())
+            labels.resize(label + 1);
+        return labels[label];
+    }
+
+    Clock::time_point start;
+    std::vector<LabelCounters> labels;
+    std::unordered_map<uint64_t, RuleCounters> rules;
+    std::vector<std::pair<std::string, double>> phases;
+    std::vector<Sample> samples;
+    unsigned sampleInterval = 0;
+    double lastSample = 0;
+    uint64_t popped = 0;
+    uint64_t derived = 0;
+    size_t peakWorklist = 0;
+    unsigned operand = 0;
+};
+
+#endif //ANSWERS_SOLVERSTATS_H
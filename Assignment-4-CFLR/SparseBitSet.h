@@ -0,0 +1,298 @@
+/**
+ * SparseBitSet.h
+ */
+
+#ifndef ANSWERS_SPARSEBITSET_H
+#define ANSWERS_SPARSEBITSET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * A set of node IDs stored as a sorted list of 64-bit words, only the non-zero words are kept.
+ * Unions are done a word at a time and report which bits they newly set.
+ * The words are allocated from a memory resource, the pool of the owning BitSetIndex.
+ */
+class SparseBitSet
+{
+    struct Block
+    {
+        unsigned index;     // bit offset / 64
+        uint64_t bits;
+    };
+
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<Block>;
+
+    SparseBitSet() = default;
+    SparseBitSet(const SparseBitSet &) = default;
+    SparseBitSet(SparseBitSet &&) = default;
+    SparseBitSet &operator=(const SparseBitSet &) = default;
+    SparseBitSet &operator=(SparseBitSet &&) = default;
+
+    explicit SparseBitSet(const allocator_type &alloc) : blocks(alloc)
+    {}
+
+    SparseBitSet(const SparseBitSet &rhs, const allocator_type &alloc) : blocks(rhs.blocks, alloc)
+    {}
+
+    SparseBitSet(SparseBitSet &&rhs, const allocator_type &alloc) : blocks(std::move(rhs.blocks), alloc)
+    {}
+
+    /// Check whether a bit is set
+    inline bool test(unsigned bit) const
+    {
+        const Block *block = findBlock(bit >> 6);
+        return block && (block->bits & mask(bit));
+    }
+
+    /**
+     * Set a bit
+     * @return true if the bit was not set before
+     */
+    inline bool set(unsigned bit)
+    {
+        unsigned index = bit >> 6;
+        size_t pos = lowerBound(index);
+        if (pos == blocks.size() || blocks[pos].index != index)
+        {
+            blocks.insert(blocks.begin() + pos, Block{index, mask(bit)});
+            return true;
+        }
+        if (blocks[pos].bits & mask(bit))
+            return false;
+        blocks[pos].bits |= mask(bit);
+        return true;
+    }
+
+    /**
+     * Clear a bit
+     * @return true if the bit was set before
+     */
+    inline bool reset(unsigned bit)
+    {
+        unsigned index = bit >> 6;
+        size_t pos = lowerBound(index);
+        if (pos == blocks.size() || blocks[pos].index != index || !(blocks[pos].bits & mask(bit)))
+            return false;
+        blocks[pos].bits &= ~mask(bit);
+        if (!blocks[pos].bits)
+            blocks.erase(blocks.begin() + pos);
+        return true;
+    }
+
+    /// Whether no bit is set
+    inline bool empty() const
+    { return blocks.empty(); }
+
+    /// Number of set bits
+    inline size_t count() const
+    {
+        size_t num = 0;
+        for (const Block &block : blocks)
+            num += __builtin_popcountll(block.bits);
+        return num;
+    }
+
+    /// Visit the set bits in ascending order
+    template<class F>
+    inline void forEach(F f) const
+    {
+        for (const Block &block : blocks)
+        {
+            for (uint64_t bits = block.bits; bits; bits &= bits - 1)
+                f((block.index << 6) | (unsigned) __builtin_ctzll(bits));
+        }
+    }
+
+    /**
+     * this |= rhs
+     * @param added receives the newly set bits in ascending order
+     * @return the number of newly set bits
+     */
+    size_t unionWith(const SparseBitSet &rhs, std::vector<unsigned> &added)
+    {
+        if (this == &rhs)
+            return 0;
+        size_t before = added.size();
+
+        // OR in place when every word of rhs already has a slot here
+        size_t i = 0;
+        bool inPlace = true;
+        for (const Block &block : rhs.blocks)
+        {
+            while (i < blocks.size() && blocks[i].index < block.index)
+                ++i;
+            if (i == blocks.size() || blocks[i].index != block.index)
+            {
+                inPlace = false;
+                break;
+            }
+        }
+
+        i = 0;
+        if (inPlace)
+        {
+            for (const Block &block : rhs.blocks)
+            {
+                while (blocks[i].index < block.index)
+                    ++i;
+                appendBits(block.index, block.bits & ~blocks[i].bits, added);
+                blocks[i].bits |= block.bits;
+            }
+            return added.size() - before;
+        }
+
+        std::pmr::vector<Block> merged(blocks.get_allocator());
+        merged.reserve(blocks.size() + rhs.blocks.size());
+        for (const Block &block : rhs.blocks)
+        {
+            while (i < blocks.size() && blocks[i].index < block.index)
+                merged.push_back(blocks[i++]);
+            uint64_t old = 0;
+            if (i < blocks.size() && blocks[i].index == block.index)
+                old = blocks[i++].bits;
+            appendBits(block.index, block.bits & ~old, added);
+            merged.push_back(Block{block.index, old | block.bits});
+        }
+        merged.insert(merged.end(), blocks.begin() + i, blocks.end());
+        blocks.swap(merged);
+        return added.size() - before;
+    }
+
+private:
+    static inline uint64_t mask(unsigned bit)
+    { return (uint64_t) 1 << (bit & 63); }
+
+    static inline void appendBits(unsigned index, uint64_t bits, std::vector<unsigned> &out)
+    {
+        for (; bits; bits &= bits - 1)
+            out.push_back((index << 6) | (unsigned) __builtin_ctzll(bits));
+    }
+
+    inline size_t lowerBound(unsigned index) const
+    {
+        size_t lo = 0, hi = blocks.size();
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            if (blocks[mid].index < index)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    inline const Block *findBlock(unsigned index) const
+    {
+        size_t pos = lowerBound(index);
+        return pos < blocks.size() && blocks[pos].index == index ? &blocks[pos] : nullptr;
+    }
+
+    std::pmr::vector<Block> blocks;     // sorted by index, no zero words
+};
+
+
+/**
+ * The edges of one label in one direction, one SparseBitSet of targets per node.
+ * Offers the same queries as AdjacencyIndex, plus unions of whole rows.
+ *
+ * The words of all rows come from one unsynchronized pool owned by the index, created on the
+ * first insertion: rows that grow or are rebuilt by unions recycle each other's blocks rather
+ * than going to the heap, and dropping the index hands the pool's chunks back at once.
+ */
+class BitSetIndex
+{
+public:
+    inline bool contains(unsigned node, unsigned target) const
+    { return node < getNodeNum() && store->rows[node].test(target); }
+
+    /**
+     * Add node -> target to the index
+     * @return true if the target was not in the row before
+     */
+    inline bool insert(unsigned node, unsigned target)
+    {
+        if (!getRow(node).set(target))
+            return false;
+        ++liveNum;
+        return true;
+    }
+
+    /**
+     * Remove node -> target from the index
+     * @return true if the target was in the row
+     */
+    inline bool erase(unsigned node, unsigned target)
+    {
+        if (node >= getNodeNum() || !store->rows[node].reset(target))
+            return false;
+        --liveNum;
+        return true;
+    }
+
+    /**
+     * rows[node] |= other.rows[otherNode]
+     * @param added receives the newly added targets
+     * @return the number of newly added targets
+     */
+    inline size_t unionRow(unsigned node, const BitSetIndex &other, unsigned otherNode, std::vector<unsigned> &added)
+    {
+        if (otherNode >= other.getNodeNum() || (&other == this && node == otherNode))
+            return 0;
+        const SparseBitSet &from = other.store->rows[otherNode];
+        size_t num = getRow(node).unionWith(from, added);
+        liveNum += num;
+        return num;
+    }
+
+    inline unsigned degree(unsigned node) const
+    { return node < getNodeNum() ? store->rows[node].count() : 0; }
+
+    inline size_t size() const
+    { return liveNum; }
+
+    inline unsigned getNodeNum() const
+    { return store ? store->rows.size() : 0; }
+
+    /// Visit the targets of a node in ascending order
+    template<class F>
+    inline void forEach(unsigned node, F f) const
+    {
+        if (node < getNodeNum())
+            store->rows[node].forEach(f);
+    }
+
+    inline void collect(unsigned node, std::vector<unsigned> &out) const
+    { forEach(node, [&](unsigned target) { out.push_back(target); }); }
+
+    /// Rows are always sorted and packed
+    inline void compact()
+    {}
+
+private:
+    /// The rows and the pool they allocate from; the rows go first when it is destroyed
+    struct Storage
+    {
+        std::pmr::unsynchronized_pool_resource pool;
+        std::pmr::vector<SparseBitSet> rows{&pool};
+    };
+
+    inline SparseBitSet &getRow(unsigned node)
+    {
+        if (!store)
+            store = std::make_unique<Storage>();
+        if (node >= store->rows.size())
+            store->rows.resize(node + 1);
+        return store->rows[node];
+    }
+
+    std::unique_ptr<Storage> store;
+    size_t liveNum = 0;
+};
+
+#endif //ANSWERS_SPARSEBITSET_H
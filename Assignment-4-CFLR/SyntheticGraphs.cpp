@@ -0,0 +1,184 @@
+/**
+ * SyntheticGraphs.cpp
+ */
+
+#include "SyntheticGraphs.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace
+{
+constexpr unsigned ChainLength = 32;
+constexpr unsigned ClusterPointerNum = 32;
+constexpr unsigned ClusterObjectNum = 4;
+}
+
+
+std::vector<CFLREdge> SyntheticGraphs::copyChain(unsigned size)
+{
+    unsigned chainNum = std::max(1u, size / ChainLength);
+    unsigned objects = 0, pointers = chainNum;
+    std::vector<CFLREdge> stmts;
+    for (unsigned i = 0; i < chainNum * ChainLength; ++i)
+    {
+        if (i % ChainLength == 0)
+            stmts.emplace_back(objects + i / ChainLength, pointers + i, Addr);
+        else
+            stmts.emplace_back(pointers + i - 1, pointers + i, Copy);
+    }
+    return stmts;
+}
+
+
+std::vector<CFLREdge> SyntheticGraphs::storeLoadWeb(unsigned size, unsigned seed)
+{
+    std::mt19937 random(seed);
+    unsigned clusterNum = std::max(1u, size / ClusterPointerNum);
+    unsigned pointers = clusterNum * ClusterObjectNum;
+    auto pick = [&](unsigned cluster) {
+        return pointers + cluster * ClusterPointerNum + random() % ClusterPointerNum;
+    };
+
+    // Draw the ends one at a time, the order of function arguments is unspecified
+    std::vector<CFLREdge> stmts;
+    auto add = [&](unsigned srcCluster, unsigned dstCluster, EdgeLabel label) {
+        unsigned src = pick(srcCluster);
+        unsigned dst = pick(dstCluster);
+        stmts.emplace_back(src, dst, label);
+    };
+    for (unsigned cluster = 0; cluster < clusterNum; ++cluster)
+    {
+        for (unsigned i = 0; i < ClusterObjectNum; ++i)
+            stmts.emplace_back(cluster * ClusterObjectNum + i, pick(cluster), Addr);
+        for (unsigned i = 0; i < ClusterPointerNum; ++i)
+        {
+            add(cluster, cluster, Store);
+            add(cluster, cluster, Load);
+            if (i % 2 == 0)
+                add(cluster, cluster, Copy);
+        }
+        // Pair the clusters up, so that flows do not run through all of them
+        if ((cluster ^ 1) < clusterNum)
+            add(cluster, cluster ^ 1, Copy);
+    }
+    return stmts;
+}
+
+
+std::vector<CFLREdge> SyntheticGraphs::heapList(unsigned size)
+{
+    size = std::max(size, 1u);
+    unsigned cells = 0, pointers = size, walkers = 2 * size;
+    std::vector<CFLREdge> stmts;
+    for (unsigned i = 0; i < size; ++i)
+    {
+        stmts.emplace_back(cells + i, pointers + i, Addr);
+        if (i + 1 < size)
+        {
+            stmts.emplace_back(pointers + i + 1, pointers + i, Store);
+            stmts.emplace_back(walkers + i, walkers + i + 1, Load);
+        }
+    }
+    stmts.emplace_back(pointers, walkers, Copy);
+    return stmts;
+}
+
+
+namespace
+{
+/// Draws ranks 0..n-1 with probability proportional to 1 / (rank + 1)^skew
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(unsigned n, double skew) : cdf(n)
+    {
+        double sum = 0;
+        for (unsigned rank = 0; rank < n; ++rank)
+            cdf[rank] = sum += std::pow(rank + 1.0, -skew);
+        for (double &p : cdf)
+            p /= sum;
+    }
+
+    template<class Random>
+    unsigned operator()(Random &random) const
+    {
+        double p = std::uniform_real_distribution<double>()(random);
+        auto it = std::upper_bound(cdf.begin(), cdf.end(), p);
+        return std::min<size_t>(it - cdf.begin(), cdf.size() - 1);
+    }
+
+private:
+    std::vector<double> cdf;
+};
+}
+
+
+std::vector<CFLREdge> SyntheticGraphs::randomProgram(const RandomProgram &shape)
+{
+    std::mt19937 random(shape.seed);
+    unsigned pointerNum = std::max(shape.pointers, 1u);
+    unsigned functionSize = std::min(std::max(shape.functionSize, 1u), pointerNum);
+    unsigned functionNum = (pointerNum + functionSize - 1) / functionSize;
+    unsigned pointers = shape.objects;
+    ZipfDistribution localUse(functionSize, shape.skew), globalUse(pointerNum, shape.skew);
+    std::bernoulli_distribution crossing(shape.crossing);
+
+    // A pointer defined in function f, and one used there: its own or, for a copy crossing
+    // functions as arguments and return values do, anyone's
+    auto define = [&](unsigned f) {
+        unsigned size = std::min(functionSize, pointerNum - f * functionSize);
+        return pointers + f * functionSize + random() % size;
+    };
+    auto use = [&](unsigned f, bool mayCross) {
+        if (mayCross && crossing(random))
+            return pointers + globalUse(random);
+        unsigned size = std::min(functionSize, pointerNum - f * functionSize);
+        return pointers + f * functionSize + localUse(random) % size;
+    };
+
+    std::vector<CFLREdge> stmts;
+    stmts.reserve(shape.objects + (size_t) (pointerNum * (shape.copies + shape.loads + shape.stores)));
+    for (unsigned object = 0; object < shape.objects; ++object)
+        stmts.emplace_back(object, define(random() % functionNum), Addr);
+
+    // Statements are spread over the functions in proportion to their size
+    auto emit = [&](double perPointer, EdgeLabel label) {
+        size_t num = (size_t) (pointerNum * perPointer);
+        for (size_t i = 0; i < num; ++i)
+        {
+            unsigned f = (unsigned) (i * functionNum / std::max<size_t>(num, 1));
+            // A store *q = p defines nothing: the value and the pointer stored through are used
+            unsigned src = use(f, label == Copy);
+            unsigned dst = label == Store ? use(f, false) : define(f);
+            stmts.emplace_back(src, dst, label);
+        }
+    };
+    emit(shape.copies, Copy);
+    emit(shape.loads, Load);
+    emit(shape.stores, Store);
+    return stmts;
+}
+
+
+bool SyntheticGraphs::generate(const std::string &kind, unsigned size, unsigned seed, std::vector<CFLREdge> &stmts)
+{
+    if (kind == "chain")
+        stmts = copyChain(size);
+    else if (kind == "web")
+        stmts = storeLoadWeb(size, seed);
+    else if (kind == "list")
+        stmts = heapList(size);
+    else if (kind == "random")
+    {
+        RandomProgram shape;
+        shape.pointers = size;
+        shape.objects = std::max(size / 10, 1u);
+        shape.seed = seed;
+        stmts = randomProgram(shape);
+    }
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,68 @@
+/**
+ * SyntheticGraphs.h
+ *
+ * Generated programs of scalable size, for benchmarking the solver without bitcode.
+ * A program is a list of statements in the form taken by CFLRGraph: edges labelled Addr
+ * (object -> pointer), Copy, Store (value -> pointer stored through) and Load (pointer
+ * loaded through -> value). Objects come first in the node numbering, then pointers.
+ */
+
+#ifndef ANSWERS_SYNTHETICGRAPHS_H
+#define ANSWERS_SYNTHETICGRAPHS_H
+
+#include "A4Header.h"
+
+namespace SyntheticGraphs
+{
+/**
+ * Chains of 32 pointers, p[0] = &o and p[i] = p[i - 1] in each, size pointers in all.
+ * Copies close transitively into VF, so the chains are kept short enough for the derived
+ * edges to grow linearly with size.
+ */
+std::vector<CFLREdge> copyChain(unsigned size);
+
+/**
+ * Clusters of 32 pointers and 4 objects, each with random stores, loads and copies among
+ * its own pointers, and every cluster copying into its neighbour: dense aliasing whose
+ * points-to sets stay bounded as size grows
+ */
+std::vector<CFLREdge> storeLoadWeb(unsigned size, unsigned seed);
+
+/**
+ * A heap linked list of size cells, p[i]->next = p[i + 1], walked step by step
+ * (w[i + 1] = w[i]->next): every step is one more load to resolve through the heap.
+ * There is no cursor walking it in a loop, as that would point to every cell
+ */
+std::vector<CFLREdge> heapList(unsigned size);
+
+/// The shape of a randomProgram
+struct RandomProgram
+{
+    unsigned pointers = 100000;
+    unsigned objects = 10000;       // each has its address taken once
+    double copies = 1.0;            // Copy statements per pointer
+    double loads = 0.2;             // Load statements per pointer
+    double stores = 0.1;            // Store statements per pointer
+    unsigned functionSize = 16;     // pointers per function
+    double crossing = 0.01;         // share of copies from a pointer of another function
+    double skew = 1.2;              // Zipf exponent of how often each pointer is used
+    unsigned seed = 1;
+};
+
+/**
+ * A program with the degree distribution of real code: pointers are grouped into functions
+ * and statements mostly stay within one, every statement defines a pointer drawn uniformly,
+ * and the pointers it uses (copied, loaded or stored through) are drawn by a Zipf law, so
+ * a few of them are used very often. Loads and stores stay within their function; copies
+ * crossing functions, as calls and returns do, copy from pointers Zipf-drawn over the whole
+ * program, the hubs that globals and common parameters make. These drive the cost of
+ * solving: every function a hub reaches aliases with every other one.
+ */
+std::vector<CFLREdge> randomProgram(const RandomProgram &shape);
+
+/// The generators by name: "chain", "web", "list" or "random" (size pointers, the default
+/// shape otherwise); false for an unknown name
+bool generate(const std::string &kind, unsigned size, unsigned seed, std::vector<CFLREdge> &stmts);
+}
+
+#endif //ANSWERS_SYNTHETICGRAPHS_H
@@ -0,0 +1,80 @@
+/**
+ * UnionFind.h
+ */
+
+#ifndef ANSWERS_UNIONFIND_H
+#define ANSWERS_UNIONFIND_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * Disjoint sets of node IDs with union by size and path halving.
+ * Nodes that were never united are their own representatives and take no space.
+ */
+class UnionFind
+{
+public:
+    /// The representative of the set holding node
+    inline unsigned find(unsigned node)
+    {
+        if (node >= parent.size())
+            return node;
+        while (parent[node] != node)
+        {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    }
+
+    /// Whether node represents its set
+    inline bool isRep(unsigned node)
+    { return find(node) == node; }
+
+    /**
+     * Merge the sets of two nodes
+     * @return the representative of the merged set, the one of the larger set
+     */
+    unsigned unite(unsigned a, unsigned b)
+    {
+        a = find(a);
+        b = find(b);
+        if (a == b)
+            return a;
+        grow(std::max(a, b) + 1);
+        if (setSize[a] < setSize[b])
+            std::swap(a, b);
+        parent[b] = a;
+        setSize[a] += setSize[b];
+        return a;
+    }
+
+    /// Put node, alone in its set, into the set represented by rep
+    void attach(unsigned node, unsigned rep)
+    {
+        grow(std::max(node, rep) + 1);
+        parent[node] = rep;
+        setSize[rep] += setSize[node];
+    }
+
+    /// One past the largest node that was ever united
+    unsigned getNodeNum() const
+    { return parent.size(); }
+
+private:
+    void grow(size_t nodeNum)
+    {
+        for (size_t node = parent.size(); node < nodeNum; ++node)
+        {
+            parent.push_back(node);
+            setSize.push_back(1);
+        }
+    }
+
+    std::vector<unsigned> parent;
+    std::vector<unsigned> setSize;
+};
+
+#endif //ANSWERS_UNIONFIND_H
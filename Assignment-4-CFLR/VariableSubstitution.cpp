@@ -0,0 +1,167 @@
+/**
+ * VariableSubstitution.cpp
+ */
+
+#include "VariableSubstitution.h"
+
+#include <algorithm>
+#include <map>
+
+namespace
+{
+enum VisitState : unsigned char
+{
+    Unvisited, Visiting, Numbered
+};
+
+/// (source, target) of the statements of some kinds
+std::vector<std::pair<unsigned, unsigned>> collectStmts(SVF::SVFIR *pag, std::initializer_list<SVF::PAGEdge::PEDGEK> kinds)
+{
+    std::vector<std::pair<unsigned, unsigned>> stmts;
+    for (auto kind : kinds)
+    {
+        for (SVF::PAGEdge *edge : pag->getSVFStmtSet(kind))
+            stmts.emplace_back(edge->getSrcID(), edge->getDstID());
+    }
+    return stmts;
+}
+
+/// (source, target) of every copy-like statement, one per operand of Phi and Select
+std::vector<std::pair<unsigned, unsigned>> collectCopies(SVF::SVFIR *pag)
+{
+    auto copies = collectStmts(pag, {SVF::PAGEdge::Copy, SVF::PAGEdge::Call, SVF::PAGEdge::Ret,
+                                     SVF::PAGEdge::ThreadFork, SVF::PAGEdge::ThreadJoin});
+    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Phi))
+    {
+        const SVF::PhiStmt *phi = SVF::SVFUtil::cast<SVF::PhiStmt>(edge);
+        for (const auto opVar : phi->getOpndVars())
+            copies.emplace_back(opVar->getId(), phi->getResID());
+    }
+    for (SVF::PAGEdge *edge : pag->getSVFStmtSet(SVF::PAGEdge::Select))
+    {
+        const SVF::SelectStmt *sel = SVF::SVFUtil::cast<SVF::SelectStmt>(edge);
+        for (const auto opVar : sel->getOpndVars())
+            copies.emplace_back(opVar->getId(), sel->getResID());
+    }
+    return copies;
+}
+}
+
+
+VariableSubstitution::VariableSubstitution(SVF::SVFIR *pag) :
+        VariableSubstitution(collectCopies(pag), collectStmts(pag, {SVF::PAGEdge::Addr}),
+                             collectStmts(pag, {SVF::PAGEdge::Store, SVF::PAGEdge::Load}))
+{}
+
+
+VariableSubstitution::VariableSubstitution(const std::vector<std::pair<unsigned, unsigned>> &copies,
+                                           const std::vector<std::pair<unsigned, unsigned>> &addrs,
+                                           const std::vector<std::pair<unsigned, unsigned>> &others)
+{
+    unsigned nodeNum = 0;
+    for (const auto *stmts : {&copies, &addrs, &others})
+    {
+        for (const auto &stmt : *stmts)
+            nodeNum = std::max(nodeNum, std::max(stmt.first, stmt.second) + 1);
+    }
+
+    // Copy sources of every node, in CSR form
+    std::vector<size_t> offsets(nodeNum + 1, 0);
+    for (const auto &copy : copies)
+        ++offsets[copy.second + 1];
+    for (unsigned node = 0; node < nodeNum; ++node)
+        offsets[node + 1] += offsets[node];
+    std::vector<unsigned> sources(copies.size());
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (const auto &copy : copies)
+        sources[fill[copy.second]++] = copy.first;
+
+    // Nodes that are not defined by copies alone get a number of their own
+    std::vector<unsigned> numbers(nodeNum);
+    std::vector<VisitState> states(nodeNum, Unvisited);
+    std::vector<bool> opaque(nodeNum, false), object(nodeNum, false);
+    for (const auto &stmt : others)
+        opaque[stmt.second] = true;
+    for (const auto &addr : addrs)
+    {
+        opaque[addr.second] = true;
+        opaque[addr.first] = object[addr.first] = true;
+    }
+    unsigned numberNum = 0;
+    for (unsigned node = 0; node < nodeNum; ++node)
+    {
+        if (opaque[node] || offsets[node] == offsets[node + 1])
+        {
+            numbers[node] = numberNum++;
+            states[node] = Numbered;
+        }
+    }
+
+    // Number copy-defined nodes after their sources with a depth-first search
+    std::map<std::vector<unsigned>, unsigned> numberOfSources;
+    std::vector<unsigned> key;
+    std::vector<std::pair<unsigned, size_t>> frames;   // node and its next source to visit
+    for (unsigned root = 0; root < nodeNum; ++root)
+    {
+        if (states[root] != Unvisited)
+            continue;
+        states[root] = Visiting;
+        frames.emplace_back(root, offsets[root]);
+        while (!frames.empty())
+        {
+            unsigned node = frames.back().first;
+            if (frames.back().second < offsets[node + 1])
+            {
+                unsigned src = sources[frames.back().second++];
+                if (states[src] == Unvisited)
+                {
+                    states[src] = Visiting;
+                    frames.emplace_back(src, offsets[src]);
+                }
+                continue;
+            }
+            frames.pop_back();
+
+            // A source still being visited closes a copy cycle; such nodes are kept apart.
+            // So is a plain copy of an object, objects are what points-to sets hold.
+            bool cyclic = false;
+            unsigned lastSrc = node;
+            key.clear();
+            for (size_t i = offsets[node]; i < offsets[node + 1]; ++i)
+            {
+                unsigned src = sources[i];
+                if (src == node)
+                    continue;
+                cyclic |= states[src] == Visiting;
+                lastSrc = src;
+                key.push_back(numbers[src]);
+            }
+            std::sort(key.begin(), key.end());
+            key.erase(std::unique(key.begin(), key.end()), key.end());
+
+            if (cyclic || key.empty() || (key.size() == 1 && object[lastSrc]))
+                numbers[node] = numberNum++;
+            else if (key.size() == 1)
+                numbers[node] = key[0];
+            else
+            {
+                auto it = numberOfSources.emplace(key, numberNum);
+                if (it.second)
+                    ++numberNum;
+                numbers[node] = it.first->second;
+            }
+            states[node] = Numbered;
+        }
+    }
+
+    // The smallest node with a number stands for all of them
+    std::vector<unsigned> firstNodes(numberNum, nodeNum);
+    reps.resize(nodeNum);
+    for (unsigned node = 0; node < nodeNum; ++node)
+    {
+        unsigned &first = firstNodes[numbers[node]];
+        if (first == nodeNum)
+            first = node;
+        reps[node] = first;
+    }
+}
@@ -0,0 +1,51 @@
+/**
+ * VariableSubstitution.h
+ */
+
+#ifndef ANSWERS_VARIABLESUBSTITUTION_H
+#define ANSWERS_VARIABLESUBSTITUTION_H
+
+#include "SVF-LLVM/SVFIRBuilder.h"
+
+#include <utility>
+#include <vector>
+
+/**
+ * Offline variable substitution over the PAG, in the style of hash-based value numbering.
+ *
+ * A pointer whose only definitions are copies (Copy, Phi, Select, Call, Ret, ThreadFork,
+ * ThreadJoin) gets a value number determined by the set of value numbers it copies from:
+ * a copy of a single pointer shares that pointer's number, and pointers copying from the
+ * same set share a fresh one. Every other node, including objects, pointers defined by
+ * Addr, Load or Store, and pointers on copy cycles, gets a number of its own. Nodes with
+ * the same number hold the same values, so the CFL graph only needs one of them.
+ */
+class VariableSubstitution
+{
+public:
+    /// Number the nodes of a PAG
+    explicit VariableSubstitution(SVF::SVFIR *pag);
+
+    /**
+     * Number the nodes of a graph given by its statements
+     * @param copies (source, target) of every copy-like statement
+     * @param addrs (object, pointer) of every Addr
+     * @param others (source, target) of every Store and Load
+     */
+    VariableSubstitution(const std::vector<std::pair<unsigned, unsigned>> &copies,
+                         const std::vector<std::pair<unsigned, unsigned>> &addrs,
+                         const std::vector<std::pair<unsigned, unsigned>> &others);
+
+    /// The node that stands for node, the smallest node ID with the same value number
+    unsigned getRep(unsigned node) const
+    { return node < reps.size() ? reps[node] : node; }
+
+    /// The representative of every node of the PAG, indexed by node ID
+    const std::vector<unsigned> &getReps() const
+    { return reps; }
+
+private:
+    std::vector<unsigned> reps;
+};
+
+#endif //ANSWERS_VARIABLESUBSTITUTION_H
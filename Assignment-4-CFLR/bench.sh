@@ -0,0 +1,30 @@
+#!/bin/bash
+
+# Runs cflr-bench over every test case and the synthetic programs, appending JSON lines
+# to bench.jsonl (or $BENCH_OUTPUT). Extra arguments are passed to cflr-bench, e.g.
+#   ./bench.sh -bench-repeat=5 -bench-mode=semi-naive -bench-threads=4
+
+cd "$(dirname "$0")"
+OUT="${BENCH_OUTPUT:-bench.jsonl}"
+
+if [ ! -x ./cflr-bench ]; then
+  echo "cflr-bench not found, build the repository first!"
+  exit 1
+fi
+
+if [ -n "${SVF_DIR}" ] && [ -d "${SVF_DIR}/llvm-16.0.0.obj" ]; then
+  export LLVM_DIR="${SVF_DIR}/llvm-16.0.0.obj"
+fi
+CLANG="${LLVM_DIR:+$LLVM_DIR/bin/}clang"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+for c in Test-Cases/*.c; do
+  ll="$TMP/$(basename "${c%.c}").ll"
+  "$CLANG" -S -emit-llvm -fno-discard-value-names -g "$c" -o "$ll" || exit 1
+  ./cflr-bench -bench-synthetic= -bench-output="$OUT" "$@" "$ll" || exit 1
+done
+
+./cflr-bench -bench-output="$OUT" "$@" || exit 1
+echo "results appended to $OUT"
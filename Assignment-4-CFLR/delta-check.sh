@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Applies the edge-list deltas in Test-Cases/Deltas (<case>.add.txt, <case>.remove.txt) to
+# each solved <case>.txt, and checks the updated graph against solving the changed program
+# anew, under every solver configuration. Extra arguments are passed to cflr.
+
+cd "$(dirname "$0")"
+
+if [ ! -x ./cflr ]; then
+  echo "cflr not found, build the repository first!"
+  exit 1
+fi
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+CONFIGS=("" "-cflr-mode=semi-naive" "-cflr-threads=4" "-cflr-bitset" "-cflr-bar-symmetry"
+         "-cflr-grammar=Grammars/PointsTo.txt" "-cflr-order=topological")
+
+fail=0
+for c in Test-Cases/Deltas/*.add.txt; do
+  name=$(basename "${c%.add.txt}")
+  # The result file is written next to the edge list
+  cp "Test-Cases/Deltas/$name.txt" "$TMP/$name.txt"
+  for config in "${CONFIGS[@]}"; do
+    if ! ./cflr -cflr-edges="$TMP/$name.txt" -cflr-add-edges="$c" \
+        -cflr-remove-edges="Test-Cases/Deltas/$name.remove.txt" -cflr-check-delta $config "$@" > "$TMP/log"; then
+      echo "FAIL $name ${config:-(default)}"
+      cat "$TMP/log"
+      fail=1
+    fi
+  done
+done
+
+[ $fail -eq 0 ] && echo "all deltas check out"
+exit $fail